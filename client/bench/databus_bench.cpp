@@ -0,0 +1,432 @@
+/*******************************************************************************************
+ *
+ * D A T A B U S - Micro Benchmarks
+ *
+ * Measures each stage of the DataBus hot path in isolation, without a socket. The
+ * wire format stages run bench/wire, which follows CModule and CUDPClient; the
+ * receive stage runs the library's CMessageBufferPool and CDeliveryQueue:
+ *
+ *   jmsg_envelope   buildEnvelope(): sendJMSG envelope construction + dump()
+ *   bmsg_assembly   buildBinaryMessage(): JSON header + '\0' + binary payload
+ *   chunk_split     splitChunks(): [chunk# lo, chunk# hi, data] datagrams
+ *   reassembly      CChunkReassembler: datagrams back into one message
+ *   parse           parsing the JSON envelope of a received message
+ *   delivery_queue  pooled CReceivedMessage through a CDeliveryQueue to a handler
+ *
+ * Every stage is swept over payload sizes (64 B .. 4 MB) and, where relevant,
+ * chunk sizes. Reports ns/op, allocations/op, allocated bytes/op and bytes
+ * copied/op, counted by interposing operator new, memcpy and memmove.
+ *
+ *   ./databus_bench                              run and print results
+ *   ./databus_bench --baseline-out base.csv      also save results as a baseline
+ *   ./databus_bench --compare base.csv [--threshold 10]
+ *                                                compare with a baseline, exit 1 on regression
+ *
+ **/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <functional>
+#include <dlfcn.h>
+
+#include "../src/de_common/helpers/json_nlohmann.hpp"
+using Json_de = nlohmann::json;
+
+#include "../src/de_common/helpers/colors.hpp"
+#include "../src/de_common/de_databus/de_module.hpp"
+#include "../src/de_capi/de_message.hpp"
+#include "../src/de_delivery/de_delivery_queue.hpp"
+#include "wire/de_wire.hpp"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+/*
+ * Allocation accounting.
+ */
+static std::atomic<uint64_t> g_allocations {0};
+static std::atomic<uint64_t> g_bytes_allocated {0};
+
+void * operator new (std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+    void * p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void * operator new[] (std::size_t size)
+{
+    return operator new(size);
+}
+
+// not inlined, so the compiler does not pair a new expression with the free() inside.
+__attribute__((noinline)) void operator delete (void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[] (void * p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete (void * p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[] (void * p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+
+/*
+ * Copy accounting. memcpy and memmove defined here take precedence over libc for
+ * the whole process, libstdc++ included, so every buffer append, string copy and
+ * dump() write of a stage is counted. Copies the compiler inlines (small fixed
+ * sizes) are not seen.
+ */
+static std::atomic<uint64_t> g_bytes_copied {0};
+
+typedef void * (*MEMCPY_FUNCTION)(void *, const void *, std::size_t);
+
+static MEMCPY_FUNCTION g_libc_memcpy = nullptr;
+static MEMCPY_FUNCTION g_libc_memmove = nullptr;
+
+extern "C" void * memcpy (void * dst, const void * src, std::size_t len)
+{
+    if (g_libc_memcpy == nullptr) g_libc_memcpy = reinterpret_cast<MEMCPY_FUNCTION>(dlsym(RTLD_NEXT, "memcpy"));
+    g_bytes_copied.fetch_add(len, std::memory_order_relaxed);
+    return g_libc_memcpy(dst, src, len);
+}
+
+extern "C" void * memmove (void * dst, const void * src, std::size_t len)
+{
+    if (g_libc_memmove == nullptr) g_libc_memmove = reinterpret_cast<MEMCPY_FUNCTION>(dlsym(RTLD_NEXT, "memmove"));
+    g_bytes_copied.fetch_add(len, std::memory_order_relaxed);
+    return g_libc_memmove(dst, src, len);
+}
+
+
+#define BENCH_MODULE_KEY    "e27e099d91de"
+
+
+typedef struct
+{
+    std::string stage;
+    std::size_t payload;
+    std::size_t chunk;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_allocated_per_op;
+    double bytes_copied_per_op;
+} BENCH_RESULT;
+
+
+static std::string resultKey (const BENCH_RESULT& result)
+{
+    return result.stage + "/" + std::to_string(result.payload) + "/" + std::to_string(result.chunk);
+}
+
+
+/**
+ * Runs op until at least min_time has passed (and at least 3 times), after a warm-up run.
+ */
+static BENCH_RESULT measure (const std::string& stage, const std::size_t payload, const std::size_t chunk, const std::function<void()>& op)
+{
+    op();
+
+    const auto min_time = std::chrono::milliseconds(200);
+    uint64_t iterations = 0;
+    g_allocations = 0;
+    g_bytes_allocated = 0;
+    g_bytes_copied = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto now = start;
+    while ((iterations < 3) || (now - start < min_time))
+    {
+        op();
+        ++iterations;
+        now = std::chrono::steady_clock::now();
+    }
+
+    const double elapsed = std::chrono::duration<double, std::nano>(now - start).count();
+
+    BENCH_RESULT result;
+    result.stage = stage;
+    result.payload = payload;
+    result.chunk = chunk;
+    result.ns_per_op = elapsed / iterations;
+    result.allocs_per_op = static_cast<double>(g_allocations.load()) / iterations;
+    result.bytes_allocated_per_op = static_cast<double>(g_bytes_allocated.load()) / iterations;
+    result.bytes_copied_per_op = static_cast<double>(g_bytes_copied.load()) / iterations;
+    return result;
+}
+
+
+static volatile std::size_t g_sink = 0;
+
+static void onReceive (const char *, int len, const Json_de& jMsg)
+{
+    g_sink = g_sink + len + jMsg[ANDRUAV_PROTOCOL_MESSAGE_TYPE].get<int>();
+}
+
+
+static Json_de makeBody (const std::size_t payload)
+{
+    Json_de body;
+    body["t"] = std::string(payload, 'x');
+    return body;
+}
+
+
+static std::vector<BENCH_RESULT> runAll ()
+{
+    const std::vector<std::size_t> payloads = {64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+    const std::vector<std::size_t> chunk_sizes = {1470, DEFAULT_UDP_DATABUS_PACKET_SIZE, 65505};
+
+    std::vector<BENCH_RESULT> results;
+
+    for (const std::size_t payload : payloads)
+    {
+        const Json_de body = makeBody(payload);
+        const std::string envelope = buildEnvelope(BENCH_MODULE_KEY, "", TYPE_AndruavMessage_DUMMY, false, body);
+        const std::vector<char> binary(payload, 'b');
+
+        Json_de message_cmd;
+        message_cmd["lat"] = 0;
+        message_cmd["lng"] = 0;
+        message_cmd["alt"] = 0;
+
+        results.push_back(measure("jmsg_envelope", payload, 0, [&]() {
+            g_sink = g_sink + buildEnvelope(BENCH_MODULE_KEY, "", TYPE_AndruavMessage_DUMMY, false, body).length();
+        }));
+
+        // the message buffer is reused across sends, as a sender would.
+        std::vector<char> binary_message;
+        results.push_back(measure("bmsg_assembly", payload, 0, [&]() {
+            const std::string header = buildEnvelope(BENCH_MODULE_KEY, "", TYPE_AndruavMessage_IMG, false, message_cmd);
+            buildBinaryMessage(header, binary.data(), binary.size(), binary_message);
+            g_sink = g_sink + binary_message.size();
+        }));
+
+        results.push_back(measure("parse", payload, 0, [&]() {
+            const Json_de jMsg = Json_de::parse(envelope);
+            g_sink = g_sink + jMsg.size();
+        }));
+
+        // as a receive handler queuing for a consumer thread does, e.g. test/receiver_adapter.cpp.
+        const Json_de parsed = Json_de::parse(envelope);
+        CDeliveryQueue delivery_queue;
+        results.push_back(measure("delivery_queue", payload, 0, [&]() {
+            delivery_queue.push(CMessageBufferPool::getInstance().acquire(envelope.c_str(), envelope.length(), parsed));
+
+            std::shared_ptr<CReceivedMessage> message;
+            while (delivery_queue.pop(message, std::chrono::milliseconds(0)))
+            {
+                onReceive(message->data(), static_cast<int>(message->size()), message->body());
+            }
+        }));
+
+        for (const std::size_t chunk_size : chunk_sizes)
+        {
+            std::vector<char> datagram;
+            results.push_back(measure("chunk_split", payload, chunk_size, [&]() {
+                splitChunks(envelope.c_str(), envelope.length(), chunk_size, datagram,
+                            [](const char *, std::size_t length) { g_sink = g_sink + length; });
+            }));
+
+            // chunks are produced outside the measured loop so only reassembly is timed.
+            std::vector<std::vector<char>> datagrams;
+            splitChunks(envelope.c_str(), envelope.length(), chunk_size, datagram,
+                        [&](const char * data, std::size_t length) { datagrams.emplace_back(data, data + length); });
+
+            CChunkReassembler reassembler;
+            results.push_back(measure("reassembly", payload, chunk_size, [&]() {
+                for (const auto& d : datagrams)
+                {
+                    reassembler.onDatagram(d.data(), d.size(), [](const char *, std::size_t length) { g_sink = g_sink + length; });
+                }
+            }));
+        }
+    }
+
+    return results;
+}
+
+
+static std::map<std::string, BENCH_RESULT> loadBaseline (const std::string& file_name)
+{
+    std::map<std::string, BENCH_RESULT> baseline;
+    std::ifstream file(file_name);
+    std::string line;
+
+    std::getline(file, line); // header
+    while (std::getline(file, line))
+    {
+        std::stringstream ss(line);
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+        if (fields.size() != 7) continue;
+
+        BENCH_RESULT result;
+        result.stage = fields[0];
+        result.payload = std::stoull(fields[1]);
+        result.chunk = std::stoull(fields[2]);
+        result.ns_per_op = std::stod(fields[3]);
+        result.allocs_per_op = std::stod(fields[4]);
+        result.bytes_allocated_per_op = std::stod(fields[5]);
+        result.bytes_copied_per_op = std::stod(fields[6]);
+        baseline[resultKey(result)] = result;
+    }
+
+    return baseline;
+}
+
+
+static void saveBaseline (const std::string& file_name, const std::vector<BENCH_RESULT>& results)
+{
+    std::ofstream file(file_name);
+    file << "stage,payload,chunk,ns_per_op,allocs_per_op,bytes_allocated_per_op,bytes_copied_per_op" << std::endl;
+    for (const auto& result : results)
+    {
+        file << result.stage << "," << result.payload << "," << result.chunk << ","
+             << std::fixed << std::setprecision(1) << result.ns_per_op << ","
+             << std::setprecision(2) << result.allocs_per_op << ","
+             << std::setprecision(1) << result.bytes_allocated_per_op << ","
+             << result.bytes_copied_per_op << std::endl;
+    }
+}
+
+
+static void printUsage ()
+{
+    std::cout << _INFO_CONSOLE_BOLD_TEXT << "DataBus micro benchmarks" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    std::cout << std::endl;
+    std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "USAGE:" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    std::cout << "  ./databus_bench [--baseline-out FILE] [--compare FILE] [--threshold PERCENT]" << std::endl;
+    std::cout << std::endl;
+    std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "OPTIONS:" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    std::cout << "  --baseline-out FILE    Save results as a baseline CSV file" << std::endl;
+    std::cout << "  --compare FILE         Compare with a baseline, exit 1 if a stage regressed or is missing" << std::endl;
+    std::cout << "  --threshold PERCENT    Allowed ns/op regression when comparing (default: 10)" << std::endl;
+    std::cout << "  -h, --help             Show this help message and exit" << std::endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string baseline_out;
+    std::string compare_with;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if ((arg == "-h") || (arg == "--help"))
+        {
+            printUsage();
+            return 0;
+        }
+        else if ((arg == "--baseline-out") && (i + 1 < argc))
+        {
+            baseline_out = argv[++i];
+        }
+        else if ((arg == "--compare") && (i + 1 < argc))
+        {
+            compare_with = argv[++i];
+        }
+        else if ((arg == "--threshold") && (i + 1 < argc))
+        {
+            threshold = std::stod(argv[++i]);
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::map<std::string, BENCH_RESULT> baseline;
+    if (!compare_with.empty())
+    {
+        baseline = loadBaseline(compare_with);
+        if (baseline.empty())
+        {
+            std::cout << _ERROR_CONSOLE_TEXT_ << "Cannot read baseline: " << compare_with << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            return 1;
+        }
+    }
+
+    const std::vector<BENCH_RESULT> results = runAll();
+
+    bool regressed = false;
+    std::set<std::string> measured;
+    std::cout << std::left << std::setw(16) << "stage" << std::right << std::setw(10) << "payload" << std::setw(8) << "chunk"
+              << std::setw(16) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(16) << "allocated/op" << std::setw(16) << "copied/op";
+    if (!baseline.empty()) std::cout << std::setw(10) << "delta";
+    std::cout << std::endl;
+
+    for (const auto& result : results)
+    {
+        std::cout << std::left << std::setw(16) << result.stage << std::right << std::setw(10) << result.payload << std::setw(8) << result.chunk
+                  << std::fixed << std::setprecision(1) << std::setw(16) << result.ns_per_op
+                  << std::setprecision(2) << std::setw(12) << result.allocs_per_op
+                  << std::setprecision(0) << std::setw(16) << result.bytes_allocated_per_op
+                  << std::setw(16) << result.bytes_copied_per_op;
+
+        const auto base = baseline.find(resultKey(result));
+        if (base != baseline.end())
+        {
+            measured.insert(base->first);
+            const double delta = (result.ns_per_op - base->second.ns_per_op) * 100.0 / base->second.ns_per_op;
+            const bool worse = (delta > threshold) || (result.allocs_per_op > base->second.allocs_per_op + 0.5);
+            std::cout << (worse ? _ERROR_CONSOLE_TEXT_ : _SUCCESS_CONSOLE_TEXT_)
+                      << std::setprecision(1) << std::setw(9) << std::showpos << delta << "%" << std::noshowpos << _NORMAL_CONSOLE_TEXT_;
+            regressed = regressed || worse;
+        }
+        std::cout << std::endl;
+    }
+
+    // a stage that no longer runs must not pass the comparison.
+    for (const auto& base : baseline)
+    {
+        if (measured.count(base.first) == 0)
+        {
+            std::cout << _ERROR_CONSOLE_TEXT_ << "Missing from this run: " << base.first << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            regressed = true;
+        }
+    }
+
+    if (!baseline_out.empty())
+    {
+        saveBaseline(baseline_out, results);
+        std::cout << _INFO_CONSOLE_TEXT << "Baseline saved to " << baseline_out << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    }
+
+    if (regressed)
+    {
+        std::cout << _ERROR_CONSOLE_TEXT_ << "Regression above " << threshold << "% or missing stage detected" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <cstring>
+
+#include "../../src/de_common/de_databus/de_module.hpp"
+
+#include "de_wire.hpp"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+std::string de::comm::buildEnvelope (const std::string& module_key, const std::string& target_party_id,
+                                     const int message_type, const bool internal_message, const Json_de& body)
+{
+    std::string msg_routing_type = CMD_COMM_GROUP;
+    if (internal_message)
+    {
+        msg_routing_type = CMD_TYPE_INTERMODULE;
+    }
+    else if (!target_party_id.empty())
+    {
+        msg_routing_type = CMD_COMM_INDIVIDUAL;
+    }
+
+    Json_de full_message;
+    full_message[INTERMODULE_MODULE_KEY] = module_key;
+    full_message[ANDRUAV_PROTOCOL_TARGET_ID] = target_party_id;
+    full_message[INTERMODULE_ROUTING_TYPE] = msg_routing_type;
+    full_message[ANDRUAV_PROTOCOL_MESSAGE_TYPE] = message_type;
+    full_message[ANDRUAV_PROTOCOL_MESSAGE_CMD] = body;
+
+    return full_message.dump();
+}
+
+
+void de::comm::buildBinaryMessage (const std::string& header, const char * payload, const std::size_t payload_length,
+                                   std::vector<char>& message)
+{
+    // c_str() brings the '\0' separator along.
+    message.resize(header.length() + 1 + payload_length);
+    std::memcpy(message.data(), header.c_str(), header.length() + 1);
+    if (payload_length > 0)
+    {
+        std::memcpy(message.data() + header.length() + 1, payload, payload_length);
+    }
+}
+
+
+std::size_t de::comm::splitChunks (const char * message, const std::size_t length, const std::size_t chunk_size,
+                                   std::vector<char>& datagram, const WIRE_DATAGRAM_CALLBACK& send)
+{
+    if (chunk_size == 0) return 0;
+
+    std::size_t remaining = length;
+    std::size_t offset = 0;
+    uint16_t chunk_number = 0;
+    std::size_t chunks = 0;
+
+    datagram.resize(std::min(chunk_size, length) + WIRE_CHUNK_HEADER_SIZE);
+    do
+    {
+        const std::size_t chunk_length = std::min(chunk_size, remaining);
+        remaining -= chunk_length;
+
+        const uint16_t number = (remaining == 0) ? WIRE_LAST_CHUNK_NUMBER : chunk_number;
+        datagram[0] = static_cast<char>(number & 0xFF);
+        datagram[1] = static_cast<char>((number >> 8) & 0xFF);
+        std::memcpy(datagram.data() + WIRE_CHUNK_HEADER_SIZE, message + offset, chunk_length);
+
+        send(datagram.data(), chunk_length + WIRE_CHUNK_HEADER_SIZE);
+
+        offset += chunk_length;
+        ++chunk_number;
+        ++chunks;
+    } while (remaining > 0);
+
+    return chunks;
+}
+
+
+bool CChunkReassembler::onDatagram (const char * datagram, const std::size_t length, const WIRE_DATAGRAM_CALLBACK& complete)
+{
+    if (length < WIRE_CHUNK_HEADER_SIZE) return false;
+
+    const uint16_t chunk_number = static_cast<uint8_t>(datagram[0]) | (static_cast<uint8_t>(datagram[1]) << 8);
+    const bool last = (chunk_number == WIRE_LAST_CHUNK_NUMBER);
+
+    if (chunk_number == 0)
+    {
+        // a new message, the previous one lost its last chunk.
+        if (m_next_chunk != 0) ++m_dropped;
+        m_message.clear();
+        m_next_chunk = 0;
+        m_broken = false;
+    }
+    else if (m_broken || (!last && (chunk_number != m_next_chunk)))
+    {
+        // a chunk went missing, skip the rest of this message.
+        if (!m_broken) ++m_dropped;
+        m_message.clear();
+        m_next_chunk = 0;
+        m_broken = !last;
+        return false;
+    }
+
+    m_message.insert(m_message.end(), datagram + WIRE_CHUNK_HEADER_SIZE, datagram + length);
+
+    if (!last)
+    {
+        ++m_next_chunk;
+        return true;
+    }
+
+    const std::size_t message_length = m_message.size();
+    m_message.push_back(0);
+    complete(m_message.data(), message_length);
+
+    m_message.clear();
+    m_next_chunk = 0;
+
+    return true;
+}
@@ -0,0 +1,101 @@
+/*******************************************************************************************
+ *
+ * D R O N E E N G A G E - D A T A B U S   W I R E   F O R M A T
+ *
+ * Envelope construction, chunking and reassembly of DataBus messages, following
+ * CModule and CUDPClient in de_common, whose code is tied to the module singleton
+ * and its socket. Bench only, not part of the library: keep it in step with
+ * de_common when the wire format changes.
+ *
+ *   envelope   {"GU": module key, "tg": target, "ty": routing, "mt": type, "ms": body}
+ *   binary     JSON envelope + '\0' + binary payload
+ *   datagram   [chunk# lo, chunk# hi, data]; the last chunk is numbered 0xFFFF, so a
+ *              message that fits in one datagram is a single 0xFFFF chunk.
+ *
+ **/
+
+#ifndef DE_WIRE_HPP_
+#define DE_WIRE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../../src/de_common/helpers/json_nlohmann.hpp"
+using Json_de = nlohmann::json;
+
+
+#define WIRE_CHUNK_HEADER_SIZE      2
+#define WIRE_LAST_CHUNK_NUMBER      0xFFFF
+
+
+namespace de
+{
+namespace comm
+{
+
+    typedef std::function<void(const char *, std::size_t)> WIRE_DATAGRAM_CALLBACK;
+
+
+    /**
+     * Serialized sendJMSG() envelope. The routing type is intermodule for internal
+     * messages, individual when target_party_id is set and group otherwise.
+     */
+    std::string buildEnvelope (const std::string& module_key, const std::string& target_party_id,
+                               const int message_type, const bool internal_message, const Json_de& body);
+
+    /**
+     * sendBMSG() message: header + '\0' + payload into message, which keeps its capacity.
+     */
+    void buildBinaryMessage (const std::string& header, const char * payload, const std::size_t payload_length,
+                             std::vector<char>& message);
+
+    /**
+     * Calls send once per chunk of at most chunk_size data bytes. datagram is the
+     * send buffer, reused across chunks and calls. Returns the number of chunks.
+     */
+    std::size_t splitChunks (const char * message, const std::size_t length, const std::size_t chunk_size,
+                             std::vector<char>& datagram, const WIRE_DATAGRAM_CALLBACK& send);
+
+
+    /**
+     * Rebuilds messages from the datagrams of one sender. Chunks are appended to one
+     * buffer that keeps its capacity, so steady state traffic reassembles without
+     * allocating. A message with a missing chunk is dropped.
+     */
+    class CChunkReassembler
+    {
+        public:
+
+            CChunkReassembler() {};
+
+            CChunkReassembler(CChunkReassembler const&) = delete;
+            void operator=(CChunkReassembler const&) = delete;
+
+        public:
+
+            /**
+             * Calls complete with the message, '\0' terminated, when datagram is its last chunk.
+             * Returns false if datagram is malformed or out of sequence.
+             */
+            bool onDatagram (const char * datagram, const std::size_t length, const WIRE_DATAGRAM_CALLBACK& complete);
+
+            /**
+             * Messages dropped because of a missing chunk.
+             */
+            uint64_t getDropped () const { return m_dropped; }
+
+        private:
+
+            std::vector<char> m_message;
+            uint32_t m_next_chunk = 0;
+            bool m_broken = false;
+            uint64_t m_dropped = 0;
+    };
+
+}
+}
+
+#endif
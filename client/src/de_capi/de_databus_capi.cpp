@@ -0,0 +1,320 @@
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../de_common/helpers/json_nlohmann.hpp"
+using Json_de = nlohmann::json;
+
+#include "../de_common/de_databus/de_module.hpp"
+
+#include "de_message.hpp"
+#include "de_databus_capi.h"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+#define UDP_MAX_DATAGRAM_SIZE   65507
+#define UDP_CHUNK_HEADER_SIZE   2
+#define IP_UDP_HEADER_SIZE      28
+#define DEFAULT_PATH_MTU        1500
+#define MIN_PATH_MTU            576
+
+
+static std::mutex g_callback_mutex;
+static de_on_receive_t g_on_receive = nullptr;
+static void * g_on_receive_user_data = nullptr;
+static de_on_message_t g_on_message = nullptr;
+static void * g_on_message_user_data = nullptr;
+
+
+/**
+ * One reference to a CReceivedMessage.
+ */
+struct de_message
+{
+    std::shared_ptr<CReceivedMessage> message;
+};
+
+
+static inline std::string toString (const char * str)
+{
+    return (str == nullptr) ? std::string() : std::string(str);
+}
+
+/**
+ * CModule accepts a plain function pointer, so route it to the C callback and its user data.
+ */
+static void onReceiveTrampoline (const char * message, int len, Json_de jMsg)
+{
+    de_on_receive_t callback;
+    void * user_data;
+    de_on_message_t message_callback;
+    void * message_user_data;
+    {
+        const std::lock_guard<std::mutex> lock(g_callback_mutex);
+        callback = g_on_receive;
+        user_data = g_on_receive_user_data;
+        message_callback = g_on_message;
+        message_user_data = g_on_message_user_data;
+    }
+
+    if (callback != nullptr)
+    {
+        callback(message, len, user_data);
+    }
+
+    if (message_callback != nullptr)
+    {
+        // the only copy of the message, CModule reuses its buffer after we return.
+        de_message_t * owned = new de_message {CMessageBufferPool::getInstance().acquire(message, len, std::move(jMsg))};
+        message_callback(owned, message_user_data);
+    }
+}
+
+
+int de_capi_version (void)
+{
+    return DE_CAPI_VERSION;
+}
+
+
+int de_module_define (const char * module_class, const char * module_id, const char * module_key,
+                      const char * module_version, const char * message_filter_json)
+{
+    try
+    {
+        Json_de message_filter = Json_de::array();
+        if ((message_filter_json != nullptr) && (message_filter_json[0] != 0))
+        {
+            message_filter = Json_de::parse(message_filter_json);
+            if (!message_filter.is_array()) return DE_CAPI_ERROR;
+        }
+
+        CModule::getInstance().defineModule(
+            toString(module_class),
+            toString(module_id),
+            toString(module_key),
+            toString(module_version),
+            message_filter);
+    }
+    catch (...)
+    {
+        return DE_CAPI_ERROR;
+    }
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_add_feature (const char * feature)
+{
+    if (feature == nullptr) return DE_CAPI_ERROR;
+
+    CModule::getInstance().addModuleFeatures(std::string(feature));
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_set_hardware (const char * hardware_serial, int hardware_type)
+{
+    CModule::getInstance().setHardware(toString(hardware_serial), static_cast<ENUM_HARDWARE_TYPE>(hardware_type));
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_set_on_receive (de_on_receive_t callback, void * user_data)
+{
+    {
+        const std::lock_guard<std::mutex> lock(g_callback_mutex);
+        g_on_receive = callback;
+        g_on_receive_user_data = user_data;
+    }
+
+    CModule::getInstance().setMessageOnReceive(&onReceiveTrampoline);
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_set_on_message (de_on_message_t callback, void * user_data)
+{
+    {
+        const std::lock_guard<std::mutex> lock(g_callback_mutex);
+        g_on_message = callback;
+        g_on_message_user_data = user_data;
+    }
+
+    CModule::getInstance().setMessageOnReceive(&onReceiveTrampoline);
+
+    return DE_CAPI_OK;
+}
+
+
+de_message_t * de_message_retain (de_message_t * message)
+{
+    if (message == nullptr) return nullptr;
+
+    return new de_message {message->message};
+}
+
+
+void de_message_release (de_message_t * message)
+{
+    delete message;
+}
+
+
+const char * de_message_data (const de_message_t * message, int * len)
+{
+    if (message == nullptr) return nullptr;
+
+    if (len != nullptr) *len = static_cast<int>(message->message->size());
+    return message->message->data();
+}
+
+
+const char * de_message_header (const de_message_t * message, int * len)
+{
+    if (message == nullptr) return nullptr;
+
+    if (len != nullptr) *len = static_cast<int>(message->message->headerSize());
+    return message->message->header();
+}
+
+
+const char * de_message_payload (const de_message_t * message, int * len)
+{
+    if (message == nullptr) return nullptr;
+
+    if (len != nullptr) *len = static_cast<int>(message->message->payloadSize());
+    return message->message->payload();
+}
+
+
+int de_message_type (const de_message_t * message)
+{
+    if (message == nullptr) return DE_CAPI_ERROR;
+
+    try
+    {
+        const Json_de& body = message->message->body();
+        if (!body.contains(ANDRUAV_PROTOCOL_MESSAGE_TYPE)) return DE_CAPI_ERROR;
+
+        return body[ANDRUAV_PROTOCOL_MESSAGE_TYPE].get<int>();
+    }
+    catch (...)
+    {
+        return DE_CAPI_ERROR;
+    }
+}
+
+
+int de_detect_chunk_size (const char * target_ip, int target_port)
+{
+    struct sockaddr_in target;
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(target_port);
+    if ((target_ip == nullptr) || (inet_pton(AF_INET, target_ip, &target.sin_addr) != 1))
+    {
+        return DEFAULT_PATH_MTU - IP_UDP_HEADER_SIZE - UDP_CHUNK_HEADER_SIZE;
+    }
+
+    // loopback has no fragmentation cost.
+    const uint32_t address = ntohl(target.sin_addr.s_addr);
+    if (((address >> 24) == 127) || (address == INADDR_ANY))
+    {
+        return UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE;
+    }
+
+    int mtu = DEFAULT_PATH_MTU;
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd >= 0)
+    {
+        if (connect(fd, (const struct sockaddr *)&target, sizeof(target)) == 0)
+        {
+            int path_mtu = 0;
+            socklen_t len = sizeof(path_mtu);
+            if (getsockopt(fd, IPPROTO_IP, IP_MTU, &path_mtu, &len) == 0)
+            {
+                mtu = path_mtu;
+            }
+        }
+        close(fd);
+    }
+
+    return std::max(mtu, MIN_PATH_MTU) - IP_UDP_HEADER_SIZE - UDP_CHUNK_HEADER_SIZE;
+}
+
+
+int de_module_init (const char * target_ip, int target_port, const char * host, int listen_port, int chunk_size)
+{
+    try
+    {
+        // the native CModule does not negotiate the chunk size, so AUTO never goes above
+        // what a legacy de_comm accepts.
+        const int auto_chunk_size = std::min(de_detect_chunk_size(target_ip, target_port), static_cast<int>(DEFAULT_UDP_DATABUS_PACKET_SIZE));
+        CModule::getInstance().init(toString(target_ip), target_port, toString(host), listen_port,
+                                    (chunk_size > DE_CAPI_CHUNK_SIZE_AUTO) ? chunk_size : auto_chunk_size);
+    }
+    catch (...)
+    {
+        return DE_CAPI_ERROR;
+    }
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_uninit (void)
+{
+    CModule::getInstance().uninit();
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_send_jmsg (const char * target_party_id, const char * json_msg, int message_type, int internal_message)
+{
+    try
+    {
+        const Json_de message = (json_msg == nullptr) ? Json_de::object() : Json_de::parse(json_msg);
+
+        CModule::getInstance().sendJMSG(toString(target_party_id), message, message_type, internal_message != 0);
+    }
+    catch (...)
+    {
+        return DE_CAPI_ERROR;
+    }
+
+    return DE_CAPI_OK;
+}
+
+
+int de_module_send_bmsg (const char * target_party_id, const char * data, int len, int message_type,
+                         int internal_message, const char * json_cmd)
+{
+    if ((data == nullptr) && (len > 0)) return DE_CAPI_ERROR;
+
+    try
+    {
+        const Json_de message_cmd = (json_cmd == nullptr) ? Json_de::object() : Json_de::parse(json_cmd);
+
+        CModule::getInstance().sendBMSG(toString(target_party_id), data, len, message_type, internal_message != 0, message_cmd);
+    }
+    catch (...)
+    {
+        return DE_CAPI_ERROR;
+    }
+
+    return DE_CAPI_OK;
+}
@@ -0,0 +1,132 @@
+/*******************************************************************************************
+ *
+ * D R O N E E N G A G E - D A T A B U S   C   A P I
+ *
+ * Stable C interface over de::comm::CModule so that non C++ clients
+ * (Python ctypes, Node.js ffi) can use the native chunking, pacing and
+ * reassembly engine instead of reimplementing the transport.
+ *
+ * All functions operate on the CModule singleton.
+ *
+ **/
+
+#ifndef DE_DATABUS_CAPI_H_
+#define DE_DATABUS_CAPI_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define DE_CAPI_EXPORT __attribute__((visibility("default")))
+#else
+#define DE_CAPI_EXPORT
+#endif
+
+#define DE_CAPI_VERSION 2
+
+#define DE_CAPI_OK       0
+#define DE_CAPI_ERROR   -1
+
+/* pass as chunk_size to de_module_init to choose it from the path to de_comm. */
+#define DE_CAPI_CHUNK_SIZE_AUTO  0
+
+/**
+ * Receive callback.
+ * message is the reassembled databus message: a JSON envelope, optionally followed
+ * by a '\0' and a binary payload. It is only valid for the duration of the call.
+ * Called on the library receiver thread.
+ */
+typedef void (*de_on_receive_t)(const char * message, int len, void * user_data);
+
+/**
+ * Owned, reference counted received message (since DE_CAPI_VERSION 2).
+ * Its buffer comes from a pool and returns to it when the last reference is released.
+ */
+typedef struct de_message de_message_t;
+
+/**
+ * Message callback.
+ * The callee owns one reference to message and must release it with de_message_release,
+ * on any thread and at any time after the call. Called on the library receiver thread.
+ */
+typedef void (*de_on_message_t)(de_message_t * message, void * user_data);
+
+DE_CAPI_EXPORT int de_capi_version (void);
+
+/**
+ * message_filter_json is a JSON array of message types e.g. "[1005, 6502]".
+ * NULL, "" and "[]" all send an empty filter, which de_comm treats as receive all messages.
+ */
+DE_CAPI_EXPORT int de_module_define (const char * module_class, const char * module_id, const char * module_key,
+                                     const char * module_version, const char * message_filter_json);
+
+DE_CAPI_EXPORT int de_module_add_feature (const char * feature);
+
+DE_CAPI_EXPORT int de_module_set_hardware (const char * hardware_serial, int hardware_type);
+
+DE_CAPI_EXPORT int de_module_set_on_receive (de_on_receive_t callback, void * user_data);
+
+/**
+ * Alternative to de_module_set_on_receive that hands over messages instead of lending them.
+ * Both callbacks can be set, each is called for every received message.
+ */
+DE_CAPI_EXPORT int de_module_set_on_message (de_on_message_t callback, void * user_data);
+
+/**
+ * Returns a new reference to message.
+ */
+DE_CAPI_EXPORT de_message_t * de_message_retain (de_message_t * message);
+
+DE_CAPI_EXPORT void de_message_release (de_message_t * message);
+
+/**
+ * The whole message. Pointers stay valid until the reference they came from is released.
+ */
+DE_CAPI_EXPORT const char * de_message_data (const de_message_t * message, int * len);
+
+/**
+ * The JSON envelope, without the '\0' separator.
+ */
+DE_CAPI_EXPORT const char * de_message_header (const de_message_t * message, int * len);
+
+/**
+ * The binary payload after the '\0', len is 0 for JSON only messages.
+ */
+DE_CAPI_EXPORT const char * de_message_payload (const de_message_t * message, int * len);
+
+/**
+ * The message type ("mt") from the envelope, DE_CAPI_ERROR if it has none.
+ */
+DE_CAPI_EXPORT int de_message_type (const de_message_t * message);
+
+/**
+ * chunk_size: DE_CAPI_CHUNK_SIZE_AUTO uses the path MTU, capped at the default
+ * DataBus packet size that every de_comm accepts. Any other value pins it.
+ */
+DE_CAPI_EXPORT int de_module_init (const char * target_ip, int target_port, const char * host, int listen_port, int chunk_size);
+
+/**
+ * Returns the largest chunk size the path to target_ip carries without IP
+ * fragmentation (the maximum datagram on loopback).
+ */
+DE_CAPI_EXPORT int de_detect_chunk_size (const char * target_ip, int target_port);
+
+DE_CAPI_EXPORT int de_module_uninit (void);
+
+/**
+ * json_msg is the message body (the "ms" field) serialized as JSON.
+ */
+DE_CAPI_EXPORT int de_module_send_jmsg (const char * target_party_id, const char * json_msg, int message_type, int internal_message);
+
+/**
+ * json_cmd is the message body (the "ms" field) serialized as JSON, data/len is the binary payload.
+ */
+DE_CAPI_EXPORT int de_module_send_bmsg (const char * target_party_id, const char * data, int len, int message_type,
+                                        int internal_message, const char * json_cmd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
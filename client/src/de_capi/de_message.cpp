@@ -0,0 +1,116 @@
+#include <cstring>
+
+#include "de_message.hpp"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+std::shared_ptr<CReceivedMessage> CMessageBufferPool::acquire (const char * message, const std::size_t len, Json_de jMsg)
+{
+    std::unique_ptr<std::vector<char>> buffer = take();
+
+    // assign() keeps the capacity of a reused buffer.
+    buffer->assign(message, message + len);
+
+    return std::make_shared<CReceivedMessage>(std::move(buffer), std::move(jMsg));
+}
+
+
+void CMessageBufferPool::setMaxFree (const std::size_t max_free)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_max_free = max_free;
+    if (m_free.size() > m_max_free)
+    {
+        m_free.resize(m_max_free);
+    }
+}
+
+
+void CMessageBufferPool::setMaxBufferSize (const std::size_t max_buffer_size)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_max_buffer_size = max_buffer_size;
+}
+
+
+std::size_t CMessageBufferPool::getFreeCount ()
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_free.size();
+}
+
+
+std::unique_ptr<std::vector<char>> CMessageBufferPool::take ()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!m_free.empty())
+        {
+            std::unique_ptr<std::vector<char>> buffer = std::move(m_free.back());
+            m_free.pop_back();
+            return buffer;
+        }
+    }
+
+    return std::make_unique<std::vector<char>>();
+}
+
+
+void CMessageBufferPool::give (std::unique_ptr<std::vector<char>> buffer)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if ((m_free.size() >= m_max_free) || (buffer->capacity() > m_max_buffer_size))
+    {
+        // freed when buffer goes out of scope.
+        return;
+    }
+
+    buffer->clear();
+    m_free.push_back(std::move(buffer));
+}
+
+
+
+CReceivedMessage::CReceivedMessage(std::unique_ptr<std::vector<char>> buffer, Json_de jMsg)
+    : m_buffer(std::move(buffer))
+{
+    const void * separator = std::memchr(m_buffer->data(), 0, m_buffer->size());
+    if (separator == nullptr)
+    {
+        m_header_size = m_buffer->size();
+        m_payload_offset = m_buffer->size();
+    }
+    else
+    {
+        m_header_size = static_cast<const char *>(separator) - m_buffer->data();
+        m_payload_offset = m_header_size + 1;
+    }
+
+    // a header is always an object, null means not parsed yet.
+    if (!jMsg.is_null())
+    {
+        std::call_once(m_body_parsed, [this, &jMsg]() { m_body = std::move(jMsg); });
+    }
+}
+
+
+CReceivedMessage::~CReceivedMessage()
+{
+    CMessageBufferPool::getInstance().give(std::move(m_buffer));
+}
+
+
+const Json_de& CReceivedMessage::body () const
+{
+    std::call_once(m_body_parsed, [this]() { m_body = Json_de::parse(header(), header() + m_header_size); });
+
+    return m_body;
+}
@@ -0,0 +1,145 @@
+/*******************************************************************************************
+ *
+ * D R O N E E N G A G E - R E C E I V E D   M E S S A G E
+ *
+ * Owned, reference counted databus message handed to receive handlers.
+ *
+ * CModule's receive buffer is only valid during the onReceive call. CReceivedMessage
+ * copies it once into a buffer taken from CMessageBufferPool, so a handler can queue
+ * it or pass it to another thread without copying again. The buffer returns to the
+ * pool when the last reference is dropped.
+ *
+ **/
+
+#ifndef DE_MESSAGE_HPP_
+#define DE_MESSAGE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../de_common/helpers/json_nlohmann.hpp"
+using Json_de = nlohmann::json;
+
+
+namespace de
+{
+namespace comm
+{
+
+    class CReceivedMessage;
+
+    /**
+     * Free list of reassembly buffers. Buffers keep their capacity, so steady state
+     * traffic receives without allocating.
+     */
+    class CMessageBufferPool
+    {
+        public:
+
+            static CMessageBufferPool& getInstance()
+            {
+                // never destroyed: messages held by static objects are released after
+                // function local statics are gone, and must still find the pool.
+                static CMessageBufferPool * instance = new CMessageBufferPool();
+
+                return *instance;
+            }
+
+            CMessageBufferPool(CMessageBufferPool const&) = delete;
+            void operator=(CMessageBufferPool const&) = delete;
+
+        private:
+
+            CMessageBufferPool() {};
+
+        public:
+
+            /**
+             * Copies message into a pooled buffer.
+             * jMsg is the header CModule already parsed, move it in to avoid parsing again.
+             */
+            std::shared_ptr<CReceivedMessage> acquire (const char * message, const std::size_t len, Json_de jMsg = nullptr);
+
+            /**
+             * Buffers kept for reuse, beyond it released buffers are freed.
+             */
+            void setMaxFree (const std::size_t max_free);
+
+            /**
+             * Buffers larger than this are freed on release instead of pooled.
+             */
+            void setMaxBufferSize (const std::size_t max_buffer_size);
+
+            std::size_t getFreeCount ();
+
+        private:
+
+            std::unique_ptr<std::vector<char>> take ();
+            void give (std::unique_ptr<std::vector<char>> buffer);
+
+        private:
+
+            std::mutex m_lock;
+            std::vector<std::unique_ptr<std::vector<char>>> m_free;
+            std::size_t m_max_free = 16;
+            std::size_t m_max_buffer_size = 4 * 1024 * 1024;
+
+        friend class CReceivedMessage;
+    };
+
+
+    /**
+     * A reassembled databus message: a JSON header, optionally followed by a '\0'
+     * and a binary payload. Shared through std::shared_ptr; immutable, so references
+     * can be used from several threads.
+     */
+    class CReceivedMessage
+    {
+        public:
+
+            CReceivedMessage(std::unique_ptr<std::vector<char>> buffer, Json_de jMsg);
+            ~CReceivedMessage();
+
+            CReceivedMessage(CReceivedMessage const&) = delete;
+            void operator=(CReceivedMessage const&) = delete;
+
+        public:
+
+            const char * data () const { return m_buffer->data(); }
+            std::size_t size () const { return m_buffer->size(); }
+
+            /**
+             * The JSON header, without the '\0' separator.
+             */
+            const char * header () const { return m_buffer->data(); }
+            std::size_t headerSize () const { return m_header_size; }
+
+            /**
+             * The binary payload after the '\0', empty for JSON only messages.
+             */
+            const char * payload () const { return m_buffer->data() + m_payload_offset; }
+            std::size_t payloadSize () const { return m_buffer->size() - m_payload_offset; }
+            bool isBinary () const { return m_payload_offset < m_buffer->size(); }
+
+            /**
+             * The parsed header, parsed on first use.
+             * Throws Json_de::parse_error if the header is not valid JSON.
+             */
+            const Json_de& body () const;
+
+        private:
+
+            std::unique_ptr<std::vector<char>> m_buffer;
+            std::size_t m_header_size;
+            std::size_t m_payload_offset;
+
+            mutable std::once_flag m_body_parsed;
+            mutable Json_de m_body;
+    };
+
+}
+}
+
+#endif
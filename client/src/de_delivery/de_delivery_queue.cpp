@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "../de_common/de_databus/de_module.hpp"
+
+#include "de_delivery_queue.hpp"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+bool CDeliveryQueue::setDeliveryPolicy (const int message_type, const int policy, const int64_t ttl_ms)
+{
+    if ((policy & DELIVERY_POLICY_TTL) && (ttl_ms <= 0)) return false;
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if (policy == DELIVERY_POLICY_NONE)
+    {
+        m_policies.erase(message_type);
+    }
+    else
+    {
+        m_policies[message_type] = POLICY {policy, std::chrono::milliseconds(ttl_ms)};
+    }
+
+    return true;
+}
+
+
+void CDeliveryQueue::setMaxMessages (const std::size_t max_messages)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_max_messages = std::max<std::size_t>(1, max_messages);
+}
+
+
+void CDeliveryQueue::push (std::shared_ptr<CReceivedMessage> message)
+{
+    std::shared_ptr<PENDING> entry = std::make_shared<PENDING>();
+    entry->received_at = std::chrono::steady_clock::now();
+    entry->message_type = -1;
+    entry->conflated = false;
+    entry->dropped = false;
+
+    try
+    {
+        const Json_de& header = message->body();
+        entry->message_type = header.value(ANDRUAV_PROTOCOL_MESSAGE_TYPE, -1);
+        entry->conflate_key = std::make_pair(entry->message_type, header.value(ANDRUAV_PROTOCOL_SENDER, std::string()));
+    }
+    catch (...)
+    {
+        // not a valid header, delivered without a policy.
+    }
+    entry->message = std::move(message);
+
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        auto policy = m_policies.find(entry->message_type);
+        if ((policy != m_policies.end()) && (policy->second.policy & DELIVERY_POLICY_CONFLATE))
+        {
+            entry->conflated = true;
+            std::shared_ptr<PENDING>& stale = m_conflate_pending[entry->conflate_key];
+            if (stale)
+            {
+                stale->dropped = true;
+                stale->message.reset();
+                --m_pending;
+                m_stats[entry->message_type].conflated += 1;
+            }
+            stale = entry;
+        }
+
+        // bounded on m_queue, dropped entries included, so a conflated stream cannot grow it.
+        while (m_queue.size() >= m_max_messages)
+        {
+            std::shared_ptr<PENDING> oldest = std::move(m_queue.front());
+            m_queue.pop_front();
+            if (oldest->dropped) continue;
+
+            if (oldest->conflated) m_conflate_pending.erase(oldest->conflate_key);
+            --m_pending;
+            m_stats[oldest->message_type].overflowed += 1;
+        }
+
+        m_queue.push_back(std::move(entry));
+        ++m_pending;
+
+        while (m_queue.front()->dropped)
+        {
+            m_queue.pop_front();
+        }
+    }
+
+    m_cond.notify_one();
+}
+
+
+bool CDeliveryQueue::pop (std::shared_ptr<CReceivedMessage>& message, const std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while (true)
+    {
+        // a zero timeout polls without entering a timed wait.
+        while (m_queue.empty())
+        {
+            if (m_closed || (std::chrono::steady_clock::now() >= deadline)) return false;
+            m_cond.wait_until(lock, deadline);
+        }
+
+        std::shared_ptr<PENDING> entry = std::move(m_queue.front());
+        m_queue.pop_front();
+        if (entry->dropped) continue;
+
+        --m_pending;
+        if (entry->conflated) m_conflate_pending.erase(entry->conflate_key);
+
+        auto policy = m_policies.find(entry->message_type);
+        if ((policy != m_policies.end()) && (policy->second.policy & DELIVERY_POLICY_TTL)
+            && (std::chrono::steady_clock::now() - entry->received_at > policy->second.ttl))
+        {
+            m_stats[entry->message_type].expired += 1;
+            continue;
+        }
+
+        message = std::move(entry->message);
+        return true;
+    }
+}
+
+
+void CDeliveryQueue::close ()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        m_closed = true;
+    }
+
+    m_cond.notify_all();
+}
+
+
+std::size_t CDeliveryQueue::size ()
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_pending;
+}
+
+
+DELIVERY_STATS CDeliveryQueue::getStats (const int message_type)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    auto stats = m_stats.find(message_type);
+    if (stats == m_stats.end()) return DELIVERY_STATS {0, 0, 0};
+
+    return stats->second;
+}
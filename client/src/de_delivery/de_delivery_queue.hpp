@@ -0,0 +1,137 @@
+/*******************************************************************************************
+ *
+ * D R O N E E N G A G E - D E L I V E R Y   Q U E U E
+ *
+ * Bounded queue between the receive handler and a slower consumer thread, with the
+ * same delivery policies as the Python and Node.js modules:
+ *
+ *  DELIVERY_POLICY_CONFLATE: only the newest pending message per type and sender is kept.
+ *  DELIVERY_POLICY_TTL:      messages older than ttl are dropped instead of delivered.
+ *
+ * The age of a message is measured on the steady clock from when it was pushed, since the
+ * sender's clock cannot be compared with ours. When the queue is full the oldest pending
+ * message is dropped and counted as an overflow.
+ *
+ **/
+
+#ifndef DE_DELIVERY_QUEUE_HPP_
+#define DE_DELIVERY_QUEUE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "../de_capi/de_message.hpp"
+
+
+// Delivery policies, can be combined.
+#define DELIVERY_POLICY_NONE            0
+#define DELIVERY_POLICY_CONFLATE        1
+#define DELIVERY_POLICY_TTL             2
+
+#define DEFAULT_DISPATCH_QUEUE_SIZE     1024
+
+
+namespace de
+{
+namespace comm
+{
+
+    typedef struct
+    {
+        uint64_t conflated;     // replaced by a newer message of the same type and sender
+        uint64_t expired;       // older than the ttl when popped
+        uint64_t overflowed;    // dropped because the queue was full
+    } DELIVERY_STATS;
+
+
+    class CDeliveryQueue
+    {
+        public:
+
+            explicit CDeliveryQueue(const std::size_t max_messages = DEFAULT_DISPATCH_QUEUE_SIZE)
+                : m_max_messages(max_messages)
+            {
+            }
+
+            CDeliveryQueue(CDeliveryQueue const&) = delete;
+            void operator=(CDeliveryQueue const&) = delete;
+
+        public:
+
+            /**
+             * policy: DELIVERY_POLICY_CONFLATE and/or DELIVERY_POLICY_TTL, DELIVERY_POLICY_NONE removes it.
+             * Returns false if DELIVERY_POLICY_TTL is set without a positive ttl_ms.
+             */
+            bool setDeliveryPolicy (const int message_type, const int policy, const int64_t ttl_ms = 0);
+
+            /**
+             * Max pending messages, at least one.
+             */
+            void setMaxMessages (const std::size_t max_messages);
+
+            /**
+             * Called from the receive handler, never blocks on the consumer.
+             */
+            void push (std::shared_ptr<CReceivedMessage> message);
+
+            /**
+             * Waits up to timeout for the next message that passes the policies.
+             * Returns false on timeout or once close() is called and the queue is drained.
+             */
+            bool pop (std::shared_ptr<CReceivedMessage>& message, const std::chrono::milliseconds timeout);
+
+            /**
+             * Wakes up pop() callers.
+             */
+            void close ();
+
+            /**
+             * Pending messages, not counting conflated ones.
+             */
+            std::size_t size ();
+
+            DELIVERY_STATS getStats (const int message_type);
+
+        private:
+
+            typedef struct
+            {
+                std::shared_ptr<CReceivedMessage> message;
+                int message_type;
+                std::chrono::steady_clock::time_point received_at;
+                std::pair<int, std::string> conflate_key;
+                bool conflated;
+                bool dropped;
+            } PENDING;
+
+            typedef struct
+            {
+                int policy;
+                std::chrono::milliseconds ttl;
+            } POLICY;
+
+        private:
+
+            std::mutex m_lock;
+            std::condition_variable m_cond;
+            // conflated messages stay in m_queue as dropped entries until they reach its front.
+            std::deque<std::shared_ptr<PENDING>> m_queue;
+            std::map<std::pair<int, std::string>, std::shared_ptr<PENDING>> m_conflate_pending;
+            std::map<int, POLICY> m_policies;
+            std::map<int, DELIVERY_STATS> m_stats;
+            std::size_t m_max_messages;
+            std::size_t m_pending = 0;
+            bool m_closed = false;
+    };
+
+}
+}
+
+#endif
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "../de_common/helpers/colors.hpp"
+
+#include "de_periodic_publisher.hpp"
+
+
+using namespace de;
+using namespace de::comm;
+
+
+#define NS_PER_SECOND   1000000000LL
+
+
+static inline int64_t monotonicNow ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return static_cast<int64_t>(now.tv_sec) * NS_PER_SECOND + now.tv_nsec;
+}
+
+
+static inline int64_t ratePeriod (const double rate)
+{
+    return std::max<int64_t>(1, std::llround(NS_PER_SECOND / rate));
+}
+
+
+CPeriodicPublisher::~CPeriodicPublisher()
+{
+    stop();
+}
+
+
+int CPeriodicPublisher::addPublisher (const double rate, PUBLISHER_CALLBACK callback)
+{
+    if (!(rate > 0) || !callback) return -1;
+
+    std::shared_ptr<PUBLISHER> publisher = std::make_shared<PUBLISHER>();
+    publisher->period_ns = ratePeriod(rate);
+    publisher->callback = std::move(callback);
+    publisher->stats = PUBLISHER_STATS {rate, 0, 0, 0, 0, 0.0};
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    publisher->id = m_next_id++;
+    m_publishers[publisher->id] = publisher;
+    joinGroup(publisher);
+
+    start();
+    arm();
+
+    return publisher->id;
+}
+
+
+bool CPeriodicPublisher::removePublisher (const int publisher_id)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    auto found = m_publishers.find(publisher_id);
+    if (found == m_publishers.end()) return false;
+
+    leaveGroup(found->second);
+    m_publishers.erase(found);
+    arm();
+
+    // a callback removing its own publisher cannot wait for itself.
+    if (m_running_thread != std::this_thread::get_id())
+    {
+        m_callback_done.wait(lock, [this, publisher_id] { return m_running_id != publisher_id; });
+    }
+
+    return true;
+}
+
+
+bool CPeriodicPublisher::setRate (const int publisher_id, const double rate)
+{
+    if (!(rate > 0)) return false;
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    auto found = m_publishers.find(publisher_id);
+    if (found == m_publishers.end()) return false;
+
+    std::shared_ptr<PUBLISHER>& publisher = found->second;
+    publisher->stats.rate = rate;
+    const int64_t period_ns = ratePeriod(rate);
+    if (period_ns != publisher->period_ns)
+    {
+        leaveGroup(publisher);
+        publisher->period_ns = period_ns;
+        joinGroup(publisher);
+    }
+
+    start();
+    arm();
+
+    return true;
+}
+
+
+bool CPeriodicPublisher::getStats (const int publisher_id, PUBLISHER_STATS& stats)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    auto found = m_publishers.find(publisher_id);
+    if (found == m_publishers.end()) return false;
+
+    stats = found->second->stats;
+
+    return true;
+}
+
+
+void CPeriodicPublisher::stop ()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!m_thread.joinable()) return;
+
+        m_stopped_called = true;
+        const uint64_t wake = 1;
+        const ssize_t written = write(m_wake_fd, &wake, sizeof(wake));
+        (void)written;
+
+        // called from a callback: the thread cannot join itself, it exits once the callback returns.
+        if (m_thread.get_id() == std::this_thread::get_id()) return;
+    }
+
+    m_thread.join();
+}
+
+
+/**
+ * Called with m_lock held.
+ */
+void CPeriodicPublisher::start ()
+{
+    if (m_thread.joinable())
+    {
+        if (!m_stopped_called) return;
+
+        // stopped from one of its callbacks and not joined yet. It exits on its own,
+        // having closed its descriptors, once it sees it is no longer the current thread.
+        m_thread.detach();
+    }
+
+    // periods passed while stopped are not overruns.
+    const int64_t now = monotonicNow();
+    for (auto& group : m_groups)
+    {
+        const int64_t period_ns = group.first;
+        if (group.second.next_deadline_ns <= now)
+        {
+            group.second.next_deadline_ns = m_epoch_ns + ((now - m_epoch_ns) / period_ns + 1) * period_ns;
+        }
+    }
+
+    m_stopped_called = false;
+    m_generation += 1;
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_thread = std::thread(&CPeriodicPublisher::InternalThreadEntry, this, m_generation, m_timer_fd, m_wake_fd);
+}
+
+
+/**
+ * Called with m_lock held. A new group gets the first deadline after now on the
+ * grid of its period from m_epoch_ns, which aligns harmonic rates.
+ */
+void CPeriodicPublisher::joinGroup (const std::shared_ptr<PUBLISHER>& publisher)
+{
+    const int64_t period_ns = publisher->period_ns;
+
+    auto group = m_groups.find(period_ns);
+    if (group == m_groups.end())
+    {
+        const int64_t now = monotonicNow();
+        if (m_epoch_ns == 0) m_epoch_ns = now;
+
+        RATE_GROUP rate_group;
+        rate_group.next_deadline_ns = m_epoch_ns + ((now - m_epoch_ns) / period_ns + 1) * period_ns;
+        group = m_groups.emplace(period_ns, std::move(rate_group)).first;
+    }
+
+    group->second.publishers.push_back(publisher);
+}
+
+
+/**
+ * Called with m_lock held.
+ */
+void CPeriodicPublisher::leaveGroup (const std::shared_ptr<PUBLISHER>& publisher)
+{
+    auto group = m_groups.find(publisher->period_ns);
+    if (group == m_groups.end()) return;
+
+    std::vector<std::shared_ptr<PUBLISHER>>& publishers = group->second.publishers;
+    publishers.erase(std::remove(publishers.begin(), publishers.end(), publisher), publishers.end());
+    if (publishers.empty())
+    {
+        m_groups.erase(group);
+    }
+}
+
+
+/**
+ * Called with m_lock held. Arms the timer for the earliest group, disarms it when there is none.
+ */
+void CPeriodicPublisher::arm ()
+{
+    if (m_timer_fd < 0) return;
+
+    struct itimerspec spec = {};
+    if (!m_groups.empty())
+    {
+        int64_t deadline = INT64_MAX;
+        for (const auto& group : m_groups)
+        {
+            deadline = std::min(deadline, group.second.next_deadline_ns);
+        }
+        spec.it_value.tv_sec = deadline / NS_PER_SECOND;
+        spec.it_value.tv_nsec = deadline % NS_PER_SECOND;
+    }
+
+    timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+
+/**
+ * The thread owns timer_fd and wake_fd and closes them when it exits.
+ */
+void CPeriodicPublisher::InternalThreadEntry (const uint64_t generation, const int timer_fd, const int wake_fd)
+{
+    typedef struct
+    {
+        std::shared_ptr<PUBLISHER> publisher;
+        int64_t deadline_ns;
+        uint64_t missed;
+    } DUE_CALL;
+
+    std::vector<DUE_CALL> due;
+
+    while (true)
+    {
+        struct pollfd fds[2] = {{timer_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) continue;
+
+            // keep serving due groups, at a coarse pace, rather than stopping every publisher.
+            std::cout << _ERROR_CONSOLE_TEXT_ << "Publisher poll failed: " << std::strerror(errno) << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            fds[0].revents = 0;
+            fds[1].revents = 0;
+        }
+
+        uint64_t expirations;
+        if (fds[0].revents & POLLIN)
+        {
+            const ssize_t n = read(timer_fd, &expirations, sizeof(expirations));
+            (void)n;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            const ssize_t n = read(wake_fd, &expirations, sizeof(expirations));
+            (void)n;
+        }
+
+        due.clear();
+        {
+            const std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_stopped_called || (generation != m_generation)) break;
+
+            // every group due by now runs on this one wakeup.
+            const int64_t now = monotonicNow();
+            for (auto& group : m_groups)
+            {
+                RATE_GROUP& rate_group = group.second;
+                if (rate_group.next_deadline_ns > now) continue;
+
+                const int64_t period_ns = group.first;
+                const int64_t deadline_ns = rate_group.next_deadline_ns;
+                const uint64_t missed = (now - deadline_ns) / period_ns;
+                rate_group.next_deadline_ns = deadline_ns + (missed + 1) * period_ns;
+
+                for (const auto& publisher : rate_group.publishers)
+                {
+                    due.push_back({publisher, deadline_ns, missed});
+                }
+            }
+
+            arm();
+        }
+
+        // callbacks run unlocked so they can send, change rates or remove publishers.
+        for (const DUE_CALL& call : due)
+        {
+            PUBLISHER& publisher = *call.publisher;
+            {
+                const std::lock_guard<std::mutex> lock(m_lock);
+                // stopped or removed by an earlier callback of this wakeup.
+                if (m_stopped_called || (generation != m_generation)) break;
+                if (m_publishers.count(publisher.id) == 0) continue;
+                m_running_id = publisher.id;
+                m_running_thread = std::this_thread::get_id();
+            }
+
+            const int64_t jitter_us = (monotonicNow() - call.deadline_ns) / 1000;
+
+            try
+            {
+                publisher.callback();
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << _ERROR_CONSOLE_TEXT_ << "Error in publisher callback " << publisher.id << ": " << e.what() << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            }
+            catch (...)
+            {
+                std::cout << _ERROR_CONSOLE_TEXT_ << "Error in publisher callback " << publisher.id << ": unknown exception" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            }
+
+            const std::lock_guard<std::mutex> lock(m_lock);
+
+            m_running_id = -1;
+            m_running_thread = std::thread::id();
+            m_callback_done.notify_all();
+
+            PUBLISHER_STATS& stats = publisher.stats;
+            stats.runs += 1;
+            stats.overruns += call.missed;
+            stats.jitter_last_us = jitter_us;
+            stats.jitter_max_us = std::max(stats.jitter_max_us, jitter_us);
+            stats.jitter_mean_us += (jitter_us - stats.jitter_mean_us) / stats.runs;
+        }
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        if (generation == m_generation)
+        {
+            m_timer_fd = -1;
+            m_wake_fd = -1;
+        }
+    }
+
+    close(timer_fd);
+    close(wake_fd);
+}
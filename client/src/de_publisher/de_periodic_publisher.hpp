@@ -0,0 +1,146 @@
+/*******************************************************************************************
+ *
+ * D R O N E E N G A G E - P E R I O D I C   P U B L I S H E R
+ *
+ * Calls producer callbacks at fixed rates from one library thread, e.g. to send
+ * telemetry with CModule::sendJMSG without a sleep loop per stream.
+ *
+ * Deadlines are absolute, on CLOCK_MONOTONIC and aligned to a common epoch, so
+ * they do not drift and harmonic rates (1, 10, 50 Hz ...) fire on the same
+ * wakeup. Publishers with the same rate form a rate group that shares one
+ * deadline. The thread sleeps on a timerfd armed for the earliest deadline and
+ * costs no wakeups while nothing is registered.
+ *
+ * A group that wakes up late by whole periods skips them instead of bursting to
+ * catch up; skipped periods are counted as overruns.
+ *
+ **/
+
+#ifndef DE_PERIODIC_PUBLISHER_HPP_
+#define DE_PERIODIC_PUBLISHER_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace de
+{
+namespace comm
+{
+
+    typedef std::function<void()> PUBLISHER_CALLBACK;
+
+    typedef struct
+    {
+        double rate;                // Hz
+        uint64_t runs;              // callbacks made
+        uint64_t overruns;          // periods skipped because the publisher ran late
+        int64_t jitter_last_us;     // call time - deadline
+        int64_t jitter_max_us;
+        double jitter_mean_us;
+    } PUBLISHER_STATS;
+
+
+    class CPeriodicPublisher
+    {
+        public:
+
+            static CPeriodicPublisher& getInstance()
+            {
+                static CPeriodicPublisher instance;
+
+                return instance;
+            }
+
+            CPeriodicPublisher(CPeriodicPublisher const&) = delete;
+            void operator=(CPeriodicPublisher const&) = delete;
+
+        private:
+
+            CPeriodicPublisher() {};
+
+        public:
+
+            ~CPeriodicPublisher();
+
+        public:
+
+            /**
+             * Calls callback rate times per second on the publisher thread.
+             * Returns a publisher id, or -1 if rate is not positive.
+             */
+            int addPublisher (const double rate, PUBLISHER_CALLBACK callback);
+
+            /**
+             * Returns once the callback is no longer running, so what it captured can be
+             * released. A callback may remove its own publisher. Returns false for unknown ids.
+             */
+            bool removePublisher (const int publisher_id);
+
+            /**
+             * Moves the publisher to the rate group of rate, from the next deadline of that group.
+             */
+            bool setRate (const int publisher_id, const double rate);
+
+            bool getStats (const int publisher_id, PUBLISHER_STATS& stats);
+
+            /**
+             * Stops the thread. Registered publishers are kept and resume on the next
+             * addPublisher() or setRate(). Called from a callback, it returns without
+             * waiting and the thread exits once the callback returns.
+             */
+            void stop ();
+
+        private:
+
+            typedef struct
+            {
+                int id;
+                int64_t period_ns;
+                PUBLISHER_CALLBACK callback;
+                PUBLISHER_STATS stats;
+            } PUBLISHER;
+
+            typedef struct
+            {
+                int64_t next_deadline_ns;
+                std::vector<std::shared_ptr<PUBLISHER>> publishers;
+            } RATE_GROUP;
+
+            void start ();
+            void joinGroup (const std::shared_ptr<PUBLISHER>& publisher);
+            void leaveGroup (const std::shared_ptr<PUBLISHER>& publisher);
+            void arm ();
+            void InternalThreadEntry (const uint64_t generation, const int timer_fd, const int wake_fd);
+
+        private:
+
+            std::mutex m_lock;
+            std::map<int, std::shared_ptr<PUBLISHER>> m_publishers;
+            // keyed by period in ns
+            std::map<int64_t, RATE_GROUP> m_groups;
+            int m_next_id = 0;
+            int64_t m_epoch_ns = 0;
+            // publisher whose callback is running, -1 for none, and the thread running it
+            int m_running_id = -1;
+            std::thread::id m_running_thread;
+            std::condition_variable m_callback_done;
+
+            int m_timer_fd = -1;
+            int m_wake_fd = -1;
+            bool m_stopped_called = false;
+            // a thread left running by start() after a stop from its callback exits when this changes
+            uint64_t m_generation = 0;
+            std::thread m_thread;
+    };
+
+}
+}
+
+#endif
@@ -8,6 +8,7 @@ using Json_de = nlohmann::json;
 
 #include "../src/de_common/helpers/colors.hpp"
 #include "../src/de_common/de_databus/de_module.hpp"
+#include "../src/de_publisher/de_periodic_publisher.hpp"
 
 
 
@@ -174,11 +175,16 @@ int main (int argc, char *argv[])
     
     std::cout << "Client Module RUNNING " << std::endl; 
     
-    while (!exit_me)
+    // 1 Hz on the publisher thread, no drift.
+    CPeriodicPublisher::getInstance().addPublisher(1.0, []()
     {
-       std::this_thread::sleep_for(std::chrono::milliseconds(1000));
        std::cout << "Client Module RUNNING " << std::endl; 
        sendMsg();
+    });
+
+    while (!exit_me)
+    {
+       std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
 
 
@@ -11,6 +11,7 @@ using Json_de = nlohmann::json;
 #include "../src/de_common/helpers/helpers.hpp"
 
 #include "../src/de_common/de_databus/de_module.hpp"
+#include "../src/de_publisher/de_periodic_publisher.hpp"
 
 
 
@@ -85,10 +86,10 @@ int main(int argc, char* argv[])
     cModule.init("0.0.0.0",60000, "0.0.0.0", 50000, DEFAULT_UDP_DATABUS_PACKET_SIZE);
     
 
-    while (!exit_me)
+    // every 10 seconds on the publisher thread.
+    std::cout << "WAITING  " << std::endl;
+    CPeriodicPublisher::getInstance().addPublisher(0.1, [content, content_length]()
     {
-       std::cout << "WAITING  " << std::endl;
-       std::this_thread::sleep_for(std::chrono::seconds(10));
        std::cout << "Sending Image: length: " << content_length << std::endl;
     
         Json_de msg_cmd;
@@ -99,6 +100,11 @@ int main(int argc, char* argv[])
         msg_cmd["tim"] = get_time_usec();
 
        cModule.sendBMSG("", content, content_length, TYPE_AndruavMessage_IMG, false, msg_cmd);
+    });
+
+    while (!exit_me)
+    {
+       std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 
     // Use the content and content_length as needed
@@ -10,9 +10,8 @@ using Json_de = nlohmann::json;
 
 #include "../src/de_common/helpers/colors.hpp"
 #include "../src/de_common/de_databus/de_module.hpp"
-
-#include <mutex>
-#include <condition_variable>
+#include "../src/de_capi/de_message.hpp"
+#include "../src/de_delivery/de_delivery_queue.hpp"
 
 
 using namespace de;
@@ -30,11 +29,6 @@ CModule& cModule= CModule::getInstance();
 #define TYPE_CUSTOM_SOME_DATA  TYPE_AndruavMessage_USER_RANGE_START+0
 #define TYPE_CUSTOM_CHANGE_RATE  TYPE_AndruavMessage_USER_RANGE_START+1
 
-std::mutex messageQueueMutex;
-std::mutex messageQueueWaitingMutex;
-
-std::condition_variable messageQueueConditionVariable;
-
 
 
 void sendMsg (int value);
@@ -53,51 +47,45 @@ std::string generateRandomModuleID() {
     return moduleID;
 }
 
-std::queue<std::vector<char>> messageQueue;
+// pooled, ref counted messages: queued without copying again, buffers are reused.
+// bounded, messages that waited longer than MESSAGE_TTL_MS are dropped unprocessed.
+#define MESSAGE_QUEUE_SIZE  100
+#define MESSAGE_TTL_MS      30000
+CDeliveryQueue messageQueue(MESSAGE_QUEUE_SIZE);
 
 
 void processMessages() {
 
-    std::unique_lock<std::mutex> lock(messageQueueMutex, std::defer_lock);
-
     std::cout << _INFO_CONSOLE_BOLD_TEXT << "Check Queue " << _NORMAL_CONSOLE_TEXT_ << std::endl;
 
     static int counter = 0;
     static int diff = 0;
 
     static int i_pid = 0;
-        
-    while (messageQueue.size()>0) {
-        //std::unique_lock<std::mutex> lock_wait(messageQueueWaitingMutex);
-        //messageQueueConditionVariable.wait(lock_wait);
 
-        // Get the front message from the queue
-        lock.lock();
-        std::vector<char>& frontMessage = messageQueue.front();
-        
+    std::shared_ptr<CReceivedMessage> frontMessage;
+    while (messageQueue.pop(frontMessage, std::chrono::milliseconds(0))) {
+
         // Process or use the front message
         // Example: Print the size of the message
-        diff = messageQueue.size() - counter + 1;
-        counter = messageQueue.size();
+        const int queued = messageQueue.size() + 1;
+        diff = queued - counter + 1;
+        counter = queued;
         std::cout << _TEXT_BOLD_HIGHTLITED_ << "PROCESS MESSAGE : " << _SUCCESS_CONSOLE_BOLD_TEXT_ << messages_processed_counter << _NORMAL_CONSOLE_TEXT_ << std::endl;
         std::cout << _TEXT_BOLD_HIGHTLITED_ << "QUEUE : " << _SUCCESS_CONSOLE_BOLD_TEXT_ << counter << " diff:" << _SUCCESS_CONSOLE_BOLD_TEXT_ << diff << _NORMAL_CONSOLE_TEXT_ << std::endl;
         
 
         #ifdef DDEBUG        
-            std::cout << _LOG_CONSOLE_TEXT << "RX MSG#" << _INFO_CONSOLE_BOLD_TEXT << messages_processed_counter << ":len " << std::to_string(frontMessage.size()) << ":" << frontMessage.data() <<   _NORMAL_CONSOLE_TEXT_ << std::endl;
+            std::cout << _LOG_CONSOLE_TEXT << "RX MSG#" << _INFO_CONSOLE_BOLD_TEXT << messages_processed_counter << ":len " << std::to_string(frontMessage->size()) << ":" << std::string(frontMessage->header(), frontMessage->headerSize()) <<   _NORMAL_CONSOLE_TEXT_ << std::endl;
         #endif
-        lock.unlock();
         
 
         std::this_thread::sleep_for(std::chrono::milliseconds(delay));
         
-        lock.lock();
-        messageQueue.pop();
-        lock.unlock();    
+        frontMessage.reset();
         
         ++messages_processed_counter;
         
-        // Pop the front message from the queue
         if ((counter > 2) && (diff>0))
         {   
             
@@ -110,6 +98,12 @@ void processMessages() {
         }
     }
 
+    const DELIVERY_STATS stats = messageQueue.getStats(TYPE_CUSTOM_SOME_DATA);
+    if (stats.expired + stats.overflowed > 0)
+    {
+        std::cout << _ERROR_CONSOLE_BOLD_TEXT_ << "DROPPED expired:" << stats.expired << " overflowed:" << stats.overflowed << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    }
+
     sendMsg(0); // send now
         
     std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "IDLE " << _NORMAL_CONSOLE_TEXT_ << std::endl;
@@ -124,37 +118,14 @@ void onReceive (const char * message, int len, Json_de jMsg)
     if (msgid == TYPE_CUSTOM_SOME_DATA)
     {
 
-        // Prepare a vector 
-        std::vector<char> msg(message, message + len);
+        // Take the message out of CModule's receive buffer.
+        std::shared_ptr<CReceivedMessage> msg = CMessageBufferPool::getInstance().acquire(message, len, std::move(jMsg));
         
         ++messages_input_counter;
 
-        // Check that it is safe to access Queue.
-        std::unique_lock<std::mutex> lock(messageQueueMutex, std::defer_lock);
-        
-        bool locked = lock.try_lock();
-        if (locked)
-        {
-            // The mutex was successfully locked
-            std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "MSG# " << _INFO_CONSOLE_BOLD_TEXT << messages_input_counter << _SUCCESS_CONSOLE_BOLD_TEXT_ << " >> QUEUE" _NORMAL_CONSOLE_TEXT_ << std::endl;
-            messageQueue.push(msg);
-            int counter = messageQueue.size();
-            lock.unlock();
-            
-            messageQueueConditionVariable.notify_one();
-        }
-        else
-        {
-            // The mutex is already locked
-            std::cout << _ERROR_CONSOLE_BOLD_TEXT_ << "QUEUE IS BEING PROCESSED" <<  _INFO_CONSOLE_BOLD_TEXT << messages_input_counter << _NORMAL_CONSOLE_TEXT_ << std::endl;
-            
-            lock.lock();
-            std::cout << _ERROR_CONSOLE_BOLD_TEXT_ << "PUSSHED" <<  _NORMAL_CONSOLE_TEXT_ << std::endl;
-            std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "MSG# " << _INFO_CONSOLE_BOLD_TEXT << messages_input_counter << _SUCCESS_CONSOLE_BOLD_TEXT_ << " >> QUEUE" _NORMAL_CONSOLE_TEXT_ << std::endl;
-            messageQueue.push(msg);
-            messageQueueConditionVariable.notify_one();
-            lock.unlock();
-        }
+        // never blocks on processMessages(), the oldest message is dropped when the queue is full.
+        std::cout << _SUCCESS_CONSOLE_BOLD_TEXT_ << "MSG# " << _INFO_CONSOLE_BOLD_TEXT << messages_input_counter << _SUCCESS_CONSOLE_BOLD_TEXT_ << " >> QUEUE" _NORMAL_CONSOLE_TEXT_ << std::endl;
+        messageQueue.push(std::move(msg));
     }
 }
 
@@ -219,6 +190,7 @@ int main (int argc, char *argv[])
     // Add Hardware Verification Info to be verified by server. [OPTIONAL]
     cModule.setHardware("123456", ENUM_HARDWARE_TYPE::HARDWARE_TYPE_CPU);
     cModule.setMessageOnReceive (&onReceive);
+    messageQueue.setDeliveryPolicy(TYPE_CUSTOM_SOME_DATA, DELIVERY_POLICY_TTL, MESSAGE_TTL_MS);
 
     cModule.init("0.0.0.0",target_port, "0.0.0.0", 70024, DEFAULT_UDP_DATABUS_PACKET_SIZE);
     
@@ -8,6 +8,7 @@ using Json_de = nlohmann::json;
 
 #include "../src/de_common/helpers/colors.hpp"
 #include "../src/de_common/de_databus/de_module.hpp"
+#include "../src/de_publisher/de_periodic_publisher.hpp"
 
 
 using namespace de;
@@ -15,7 +16,7 @@ using namespace de::comm;
 bool exit_me = false;
 int delay = 1000;
 int counter = 0;
-std::chrono::time_point<std::chrono::system_clock> oldnow = std::chrono::system_clock::now();
+int publisher_id = -1;
 
 
 #define MESSAGE_FILTER {TYPE_AndruavMessage_USER_RANGE_START+1,\
@@ -59,6 +60,11 @@ void onReceive (const char * message, int len, Json_de jMsg)
         if (delta_delay==0) 
         {
             delay = delay / 2;
+            if (delay < 10)
+            {
+                delay = 10;
+            }
+            CPeriodicPublisher::getInstance().setRate(publisher_id, 1000.0 / delay);
             sendMsg();
             return ;
         }       
@@ -72,6 +78,7 @@ void onReceive (const char * message, int len, Json_de jMsg)
             delay = 10;
         }
             
+        CPeriodicPublisher::getInstance().setRate(publisher_id, 1000.0 / delay);
     }
 }
 
@@ -140,19 +147,24 @@ int main (int argc, char *argv[])
     
     std::cout << "RUNNING " << std::endl; 
     
+    // one message every delay ms, onReceive changes the rate at runtime.
+    publisher_id = CPeriodicPublisher::getInstance().addPublisher(1000.0 / delay, []()
+    {
+        std::cout << _LOG_CONSOLE_TEXT << "Next Message in " << _INFO_CONSOLE_BOLD_TEXT << delay << _LOG_CONSOLE_TEXT << " ms" << _NORMAL_CONSOLE_TEXT_ <<  std::endl; 
+        std::cout << _TEXT_BOLD_HIGHTLITED_ << "SENDING MESSAGE NUMBER:" << _SUCCESS_CONSOLE_BOLD_TEXT_ << counter << _NORMAL_CONSOLE_TEXT_ << std::endl; 
+        sendMsg();
+    });
+
     while (!exit_me)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
-        std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-        if (now - oldnow > std::chrono::milliseconds(delay)) {
-            std::cout << _LOG_CONSOLE_TEXT << "Next Message in " << _INFO_CONSOLE_BOLD_TEXT << delay << _LOG_CONSOLE_TEXT << " ms" << _NORMAL_CONSOLE_TEXT_ <<  std::endl; 
-            oldnow = now;
-            std::cout << _TEXT_BOLD_HIGHTLITED_ << "SENDING MESSAGE NUMBER:" << _SUCCESS_CONSOLE_BOLD_TEXT_ << counter << _NORMAL_CONSOLE_TEXT_ << std::endl; 
-            sendMsg();
+        PUBLISHER_STATS stats;
+        if (CPeriodicPublisher::getInstance().getStats(publisher_id, stats))
+        {
+            std::cout << _LOG_CONSOLE_TEXT << "rate:" << stats.rate << " Hz runs:" << stats.runs << " overruns:" << stats.overruns
+                      << " jitter mean:" << stats.jitter_mean_us << " us max:" << stats.jitter_max_us << " us" << _NORMAL_CONSOLE_TEXT_ << std::endl;
         }
-        
     }
 
 
@@ -1,12 +1,11 @@
 const readline = require('readline');
 const dgram = require('dgram');
 const CModule = require('./de_module'); // Adjust the path as necessary
+const { UDP_DATABUS_PACKET_SIZE_AUTO } = require('./udpClient');
 const {CMyFacade} = require('./my_facade'); // Adjust path as necessary
 const { TYPE_AndruavMessage_RemoteExecute, TYPE_AndruavMessage_FlightControl, TYPE_AndruavMessage_GeoFence, TYPE_AndruavMessage_ExternalGeoFence, TYPE_AndruavMessage_Arm, TYPE_AndruavMessage_ChangeAltitude, TYPE_AndruavMessage_Land, TYPE_AndruavMessage_GuidedPoint, TYPE_AndruavMessage_CirclePoint, TYPE_AndruavMessage_DoYAW, TYPE_AndruavMessage_DistinationLocation, TYPE_AndruavMessage_ChangeSpeed, TYPE_AndruavMessage_TrackingTargetLocation, TYPE_AndruavMessage_UploadWayPoints, TYPE_AndruavMessage_RemoteControlSettings, TYPE_AndruavMessage_SET_HOME_LOCATION, TYPE_AndruavMessage_RemoteControl2, TYPE_AndruavMessage_LightTelemetry, TYPE_AndruavMessage_ServoChannel, TYPE_AndruavMessage_Sync_EventFire, TYPE_AndruavMessage_MAVLINK, TYPE_AndruavMessage_SWARM_MAVLINK, TYPE_AndruavMessage_MAKE_SWARM, TYPE_AndruavMessage_FollowHim_Request, TYPE_AndruavMessage_FollowMe_Guided, TYPE_AndruavMessage_UpdateSwarm, TYPE_AndruavMessage_UDPProxy_Info, TYPE_AndruavSystem_UdpProxy, TYPE_AndruavMessage_P2P_ACTION, TYPE_AndruavMessage_P2P_STATUS, NOTIFICATION_TYPE_NOTICE, ERROR_USER_DEFINED, NOTIFICATION_TYPE_INFO } = require('./messages'); // Adjust path as necessary
 const { INFO_CONSOLE_TEXT, INFO_CONSOLE_BOLD_TEXT, NORMAL_CONSOLE_TEXT, SUCCESS_CONSOLE_BOLD_TEXT } = require('./colors'); // Adjust path as necessary
 
-const DEFAULT_UDP_DATABUS_PACKET_SIZE = 8192;
-
 // Message filter matching C++ implementation
 const MESSAGE_FILTER = [
     TYPE_AndruavMessage_RemoteExecute,
@@ -42,14 +41,14 @@ const MESSAGE_FILTER = [
 ];
 
 let shutdownRequested = false;
-let intervalId = null;
+let publisherId = null;
 
 // Signal handlers for graceful shutdown
 process.on('SIGINT', () => {
     console.log(`\n${INFO_CONSOLE_TEXT}Received SIGINT, shutting down gracefully...${NORMAL_CONSOLE_TEXT}`);
     shutdownRequested = true;
-    if (intervalId) {
-        clearInterval(intervalId);
+    if (publisherId !== null) {
+        cModule.removePeriodicPublisher(publisherId);
     }
     cleanupAndExit();
 });
@@ -57,8 +56,8 @@ process.on('SIGINT', () => {
 process.on('SIGTERM', () => {
     console.log(`\n${INFO_CONSOLE_TEXT}Received SIGTERM, shutting down gracefully...${NORMAL_CONSOLE_TEXT}`);
     shutdownRequested = true;
-    if (intervalId) {
-        clearInterval(intervalId);
+    if (publisherId !== null) {
+        cModule.removePeriodicPublisher(publisherId);
     }
     cleanupAndExit();
 });
@@ -199,17 +198,15 @@ if (require.main === module) {
     // Add Hardware Verification Info to be verified by the server. [OPTIONAL]
     cModule.setHardware("123456", 1); // HARDWARE_TYPE_CPU
 
-    cModule.init("0.0.0.0", targetPort, "0.0.0.0", listenPort, DEFAULT_UDP_DATABUS_PACKET_SIZE);
+    cModule.init("0.0.0.0", targetPort, "0.0.0.0", listenPort, UDP_DATABUS_PACKET_SIZE_AUTO);
 
     console.log("Client Module RUNNING");
 
-    // Replace infinite setInterval with shutdown-aware loop
-    intervalId = setInterval(() => {
+    // Send once a second from the module's periodic publisher
+    publisherId = cModule.addPeriodicPublisher(1, () => {
         if (!shutdownRequested) {
             console.log("Client Module RUNNING");
             sendMsg();
-        } else {
-            clearInterval(intervalId);
         }
-    }, 1000);
+    });
 }
\ No newline at end of file
@@ -1,22 +1,65 @@
 const dgram = require('dgram');
 const { EventEmitter } = require('events');
+const { performance } = require('perf_hooks');
 const AsyncLock = require('async-lock');
 
-const { ANDRUAV_PROTOCOL_TARGET_ID, ANDRUAV_PROTOCOL_MESSAGE_TYPE, ANDRUAV_PROTOCOL_MESSAGE_CMD, INTERMODULE_ROUTING_TYPE, CMD_COMM_SYSTEM, CMD_COMM_GROUP, CMD_COMM_INDIVIDUAL, CMD_TYPE_INTERMODULE, JSON_INTERMODULE_MODULE_KEY, JSON_INTERMODULE_MODULE_ID, JSON_INTERMODULE_MODULE_CLASS, JSON_INTERMODULE_MODULE_MESSAGES_LIST, JSON_INTERMODULE_MODULE_FEATURES, JSON_INTERMODULE_HARDWARE_ID, JSON_INTERMODULE_HARDWARE_TYPE, JSON_INTERMODULE_VERSION, JSON_INTERMODULE_RESEND, JSON_INTERMODULE_TIMESTAMP_INSTANCE, JSON_INTERMODULE_PARTY_RECORD, TYPE_AndruavModule_ID, TYPE_AndruavMessage_DUMMY, SPECIAL_NAME_SYS_NAME } = require('./messages.js'); // Adjust path as necessary
+const { ANDRUAV_PROTOCOL_TARGET_ID, ANDRUAV_PROTOCOL_MESSAGE_TYPE, ANDRUAV_PROTOCOL_MESSAGE_CMD, INTERMODULE_ROUTING_TYPE, CMD_COMM_SYSTEM, CMD_COMM_GROUP, CMD_COMM_INDIVIDUAL, CMD_TYPE_INTERMODULE, JSON_INTERMODULE_MODULE_KEY, JSON_INTERMODULE_MODULE_ID, JSON_INTERMODULE_MODULE_CLASS, JSON_INTERMODULE_MODULE_MESSAGES_LIST, JSON_INTERMODULE_MODULE_FEATURES, JSON_INTERMODULE_HARDWARE_ID, JSON_INTERMODULE_HARDWARE_TYPE, JSON_INTERMODULE_VERSION, JSON_INTERMODULE_RESEND, JSON_INTERMODULE_TIMESTAMP_INSTANCE, JSON_INTERMODULE_CHUNK_SIZE, JSON_INTERMODULE_PARTY_RECORD, TYPE_AndruavModule_ID, TYPE_AndruavModule_RemoteExecute, TYPE_AndruavMessage_DUMMY, TYPE_AndruavMessage_LightTelemetry, TYPE_AndruavMessage_MAVLINK, TYPE_AndruavMessage_SWARM_MAVLINK, TYPE_AndruavMessage_IMG, SPECIAL_NAME_SYS_NAME, ANDRUAV_PROTOCOL_SENDER, ANDRUAV_PROTOCOL_GROUP_ID, ANDRUAV_PROTOCOL_CORRELATION_ID, INTERMODULE_MODULE_KEY } = require('./messages.js'); // Adjust path as necessary
 const CUDPClient = require('./udpClient'); // Adjust path as necessary
+const { UDP_DATABUS_PACKET_SIZE_AUTO } = require('./udpClient');
+const { UDP_CHUNK_HEADER_SIZE, UDP_LAST_CHUNK_NUMBER } = require('./transport');
+const CTimerWheel = require('./timerWheel');
+const CPeriodicPublisher = require('./periodicPublisher');
 
 const { MODULE_FEATURE_RECEIVING_TELEMETRY, MODULE_FEATURE_SENDING_TELEMETRY, MODULE_FEATURE_CAPTURE_IMAGE, MODULE_FEATURE_CAPTURE_VIDEO, MODULE_FEATURE_GPIO, MODULE_FEATURE_AI_RECOGNITION, MODULE_FEATURE_TRACKING, MODULE_FEATURE_P2P, MODULE_CLASS_COMM, MODULE_CLASS_FCB, MODULE_CLASS_VIDEO, MODULE_CLASS_P2P, MODULE_CLASS_GENERIC, MODULE_CLASS_GPIO, MODULE_CLASS_A_RECOGNITION, MODULE_CLASS_TRACKING } = require('./messages.js');
 
 const HARDWARE_TYPE_UNDEFINED = 0;
 const HARDWARE_TYPE_CPU = 1;
 
+const DEFAULT_REQUEST_TIMEOUT = 5000; // ms
+
+// Delivery policies, can be combined.
+const DELIVERY_POLICY_NONE = 0;
+const DELIVERY_POLICY_CONFLATE = 1;   // keep only the newest pending message per type and sender
+const DELIVERY_POLICY_TTL = 2;        // drop messages older than ttl before dispatch
+
+const DEFAULT_DISPATCH_QUEUE_SIZE = 1024;   // pending messages, the oldest is dropped when full
+
+// de_comm liveness
+const DEFAULT_LIVENESS_DEADLINE = 5000;     // ms without traffic from de_comm before the link is down
+const LINK_ID_RETRY_INTERVAL = 250;         // ID resend interval while disconnected or probing
+const LINK_HEARTBEAT_INTERVAL_MIN = 1000;   // ID interval right after (re)connection
+const LINK_HEARTBEAT_INTERVAL_MAX = 8000;   // ID interval once the link is stable, capped to half the deadline
+
+// Outbound messages sent while de_comm is unreachable are kept in a bounded
+// buffer and flushed on reconnection. When it is full the oldest message of
+// the lowest priority not above the new one is dropped.
+const OUTAGE_PRIORITY_DROP = 0;             // never buffered
+const OUTAGE_PRIORITY_LOW = 1;
+const OUTAGE_PRIORITY_NORMAL = 2;
+const OUTAGE_PRIORITY_HIGH = 3;
+
+const DEFAULT_OUTAGE_BUFFER_MESSAGES = 256;
+const DEFAULT_OUTAGE_BUFFER_BYTES = 4 * 1024 * 1024;
+
+const DEFAULT_OUTAGE_PRIORITIES = [
+    [TYPE_AndruavMessage_LightTelemetry, OUTAGE_PRIORITY_DROP],
+    [TYPE_AndruavMessage_MAVLINK, OUTAGE_PRIORITY_DROP],
+    [TYPE_AndruavMessage_SWARM_MAVLINK, OUTAGE_PRIORITY_DROP],
+    [TYPE_AndruavMessage_IMG, OUTAGE_PRIORITY_DROP]
+];
+
 class CModule extends EventEmitter {
-    constructor() {
+    /**
+     * @param {boolean} [shared] false creates a module separate from the process wide one, see createInstance().
+     */
+    constructor(shared = true) {
         super();
-        if (CModule._instance) {
-            return CModule._instance;
+        if (shared) {
+            if (CModule._instance) {
+                return CModule._instance;
+            }
+            CModule._instance = this;
         }
-        CModule._instance = this;
 
         this.m_module_class = "";
         this.m_module_id = "";
@@ -34,22 +77,84 @@ class CModule extends EventEmitter {
         this.m_hardware_serial_type = "";
         this.m_instance_time_stamp = Date.now();
         this.m_lock = new AsyncLock(); // Use async-lock for reentrant locking
-        return CModule._instance;
+        this.m_pending_requests = new Map();
+        this.m_request_counter = 0;
+        this.m_timer_wheel = new CTimerWheel();
+        this.m_delivery_policies = new Map();
+        this.m_dispatch_queue = [];
+        this.m_dispatch_head = 0;
+        this.m_dispatch_scheduled = false;
+        this.m_conflate_pending = new Map();
+        this.m_delivery_stats = { conflate: {}, ttl: {}, overflow: {} };
+        this.m_dispatch_queue_size = DEFAULT_DISPATCH_QUEUE_SIZE;
+        this.m_link_connected = false;
+        this.m_last_received = 0;
+        this.m_liveness_deadline = DEFAULT_LIVENESS_DEADLINE;
+        this.m_heartbeat_interval = LINK_HEARTBEAT_INTERVAL_MIN;
+        this.m_link_probing = false;
+        this.m_outage_priorities = new Map(DEFAULT_OUTAGE_PRIORITIES);
+        // priority -> { entries, head } oldest first, entries are { sequence, msg, length }
+        this.m_outage_buffer = new Map();
+        this.m_outage_buffer_count = 0;
+        this.m_outage_buffer_bytes = 0;
+        this.m_outage_sequence = 0;
+        this.m_outage_max_messages = DEFAULT_OUTAGE_BUFFER_MESSAGES;
+        this.m_outage_max_bytes = DEFAULT_OUTAGE_BUFFER_BYTES;
+        this.m_outage_stats = { flushed: 0, dropped: {} };
+        this.m_forwarding_rules = new Map();
+        this.m_forwarding_rule_counter = 0;
+        this.m_forward_rule = null;
+        this.m_forward_stats = { cut_through: 0, stored: 0 };
+        this.m_publisher = new CPeriodicPublisher();
+    }
+
+    /**
+     * A module separate from the process wide new CModule(), e.g. to connect several
+     * modules over a CMemoryNetwork inside one process.
+     */
+    static createInstance() {
+        return new CModule(false);
     }
 
-    init(target_ip, broadcasts_port, host, listening_port, chunk_size) {
-        this.cUDPClient = new CUDPClient();
+    /**
+     * @param {number} [chunk_size] UDP_DATABUS_PACKET_SIZE_AUTO (0) chooses it from the path to de_comm, any other value pins it.
+     * @param {CTransport} [transport] transport to use instead of UDP e.g. CMemoryTransport or CNetworkEmulator.
+     */
+    init(target_ip, broadcasts_port, host, listening_port, chunk_size = UDP_DATABUS_PACKET_SIZE_AUTO, transport = null) {
+        this.cUDPClient = transport || new CUDPClient();
         this.cUDPClient.init(target_ip, broadcasts_port, host, listening_port, chunk_size, this.onReceive.bind(this));
         this.createJSONID(true);
+        this.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL);
+        this.cUDPClient.setIdTickCallback(() => this.onLinkTick());
+        this.cUDPClient.setChunkHandler((datagram, chunkNumber, first) => this.onChunk(datagram, chunkNumber, first));
         this.cUDPClient.start();
+        this.m_publisher.start();
         return true;
     }
 
     uninit() {
+        this.m_publisher.stop();
         this.cUDPClient.stop();
+        this.m_timer_wheel.stop();
+        for (const [correlation_id, request] of this.m_pending_requests) {
+            request.timer.cancel();
+            request.reject(new Error(`request ${correlation_id} cancelled`));
+        }
+        this.m_pending_requests.clear();
+        this.m_dispatch_queue = [];
+        this.m_dispatch_head = 0;
+        this.m_conflate_pending.clear();
         return true;
     }
 
+    /**
+     * Pin the chunk size instead of negotiating it. Call after init().
+     */
+    setChunkSize(chunk_size) {
+        this.cUDPClient.setChunkSize(chunk_size, true);
+        this.createJSONID(!this.m_FirstReceived || this.m_link_probing);
+    }
+
     defineModule(module_class, module_id, module_key, module_version, message_filter) {
         this.m_module_class = module_class;
         this.m_module_id = module_id;
@@ -58,6 +163,127 @@ class CModule extends EventEmitter {
         this.m_message_filter = message_filter;
     }
 
+    /**
+     * Set how received messages of a type are delivered to m_OnReceive.
+     * Once a policy is set, received messages are queued and delivered one per
+     * event loop turn, so datagrams that arrive while the consumer is busy are
+     * conflated or expired before they reach it.
+     *
+     * @param {number} policy DELIVERY_POLICY_CONFLATE and/or DELIVERY_POLICY_TTL
+     * @param {number} [ttl] max age in ms, required with DELIVERY_POLICY_TTL. Measured from
+     *        when the message was received.
+     */
+    setDeliveryPolicy(andruav_message_id, policy, ttl) {
+        if ((policy & DELIVERY_POLICY_TTL) && !ttl) {
+            throw new Error("DELIVERY_POLICY_TTL requires ttl");
+        }
+        if (policy === DELIVERY_POLICY_NONE) {
+            this.m_delivery_policies.delete(andruav_message_id);
+        } else {
+            this.m_delivery_policies.set(andruav_message_id, { policy: policy, ttl: ttl });
+        }
+    }
+
+    /**
+     * Max messages waiting for dispatch, the oldest is dropped and counted as overflow when full.
+     */
+    setDispatchQueueSize(max_messages) {
+        if (!(max_messages > 0)) {
+            throw new Error("max_messages must be positive");
+        }
+        this.m_dispatch_queue_size = max_messages;
+    }
+
+    /**
+     * Dropped message counters per reason and message type e.g. { conflate: { 2022: 10 }, ttl: {}, overflow: {} }.
+     */
+    getDeliveryStats() {
+        return {
+            conflate: Object.assign({}, this.m_delivery_stats.conflate),
+            ttl: Object.assign({}, this.m_delivery_stats.ttl),
+            overflow: Object.assign({}, this.m_delivery_stats.overflow)
+        };
+    }
+
+    countDrop(policyName, messageType) {
+        const counters = this.m_delivery_stats[policyName];
+        counters[messageType] = (counters[messageType] || 0) + 1;
+    }
+
+    dispatch(message, len, jMsg) {
+        if (this.m_delivery_policies.size === 0 && this.m_dispatch_head === this.m_dispatch_queue.length) {
+            if (this.m_OnReceive) {
+                this.m_OnReceive(message, len, jMsg);
+            }
+            return;
+        }
+
+        const messageType = jMsg[ANDRUAV_PROTOCOL_MESSAGE_TYPE];
+        const policy = this.m_delivery_policies.get(messageType);
+        // age is measured on the local monotonic clock from now: the sender's clock cannot be compared with ours.
+        const entry = { message: message, len: len, jMsg: jMsg, conflateKey: null, receivedAt: performance.now(), dropped: false };
+        if (policy && (policy.policy & DELIVERY_POLICY_CONFLATE)) {
+            entry.conflateKey = `${messageType}:${jMsg[ANDRUAV_PROTOCOL_SENDER] || ""}`;
+            const stale = this.m_conflate_pending.get(entry.conflateKey);
+            if (stale) {
+                stale.dropped = true;
+                this.countDrop('conflate', messageType);
+            }
+            this.m_conflate_pending.set(entry.conflateKey, entry);
+        }
+        while (this.m_dispatch_queue.length - this.m_dispatch_head >= this.m_dispatch_queue_size) {
+            const oldest = this.m_dispatch_queue[this.m_dispatch_head++];
+            if (oldest.dropped) continue;
+            if (oldest.conflateKey !== null) {
+                this.m_conflate_pending.delete(oldest.conflateKey);
+            }
+            this.countDrop('overflow', oldest.jMsg[ANDRUAV_PROTOCOL_MESSAGE_TYPE]);
+        }
+        this.m_dispatch_queue.push(entry);
+
+        if (!this.m_dispatch_scheduled) {
+            this.m_dispatch_scheduled = true;
+            setImmediate(() => this.dispatchNext());
+        }
+    }
+
+    dispatchNext() {
+        this.m_dispatch_scheduled = false;
+
+        while (this.m_dispatch_head < this.m_dispatch_queue.length) {
+            const entry = this.m_dispatch_queue[this.m_dispatch_head++];
+            if (entry.dropped) continue;
+            if (entry.conflateKey !== null) {
+                this.m_conflate_pending.delete(entry.conflateKey);
+            }
+
+            const messageType = entry.jMsg[ANDRUAV_PROTOCOL_MESSAGE_TYPE];
+            const policy = this.m_delivery_policies.get(messageType);
+            if (policy && (policy.policy & DELIVERY_POLICY_TTL) && (performance.now() - entry.receivedAt > policy.ttl)) {
+                this.countDrop('ttl', messageType);
+                continue;
+            }
+
+            if (this.m_OnReceive) {
+                try {
+                    this.m_OnReceive(entry.message, entry.len, entry.jMsg);
+                } catch (e) {
+                    console.error(`ERROR: ${e}`);
+                }
+            }
+            // one delivery per turn, let pending datagrams be received (and conflated) first.
+            break;
+        }
+
+        if (this.m_dispatch_head < this.m_dispatch_queue.length) {
+            this.m_dispatch_scheduled = true;
+            setImmediate(() => this.dispatchNext());
+        } else {
+            this.m_dispatch_queue = [];
+            this.m_dispatch_head = 0;
+        }
+    }
+
     addModuleFeatures(feature) {
         this.m_module_features.push(feature);
     }
@@ -67,10 +293,162 @@ class CModule extends EventEmitter {
         this.m_hardware_serial_type = hardware_serial_type;
     }
 
-    sendMSG(msg, length) {
+    sendMSG(msg, length, andruav_message_id) {
+        if (!this.m_link_connected && this.bufferOutbound(msg, length, andruav_message_id)) {
+            return;
+        }
         this.cUDPClient.sendMSG(msg, length);
     }
 
+    isLinkConnected() {
+        return this.m_link_connected;
+    }
+
+    /**
+     * Milliseconds without any message from de_comm before the link is considered down.
+     */
+    setLivenessDeadline(deadline) {
+        this.m_liveness_deadline = deadline;
+    }
+
+    /**
+     * Bound the buffer of outbound messages kept while de_comm is unreachable. 0 disables buffering.
+     */
+    setOutageBuffer(max_messages, max_bytes = DEFAULT_OUTAGE_BUFFER_BYTES) {
+        this.m_outage_max_messages = max_messages;
+        this.m_outage_max_bytes = max_bytes;
+    }
+
+    /**
+     * OUTAGE_PRIORITY_* used for messages of this type sent during an outage.
+     */
+    setOutagePriority(andruav_message_id, priority) {
+        this.m_outage_priorities.set(andruav_message_id, priority);
+    }
+
+    /**
+     * e.g. { buffered: 3, flushed: 40, dropped: { 0: 120 } } dropped counters are per OUTAGE_PRIORITY_*.
+     */
+    getOutageStats() {
+        return {
+            buffered: this.m_outage_buffer_count,
+            flushed: this.m_outage_stats.flushed,
+            dropped: Object.assign({}, this.m_outage_stats.dropped)
+        };
+    }
+
+    countOutageDrop(priority) {
+        const dropped = this.m_outage_stats.dropped;
+        dropped[priority] = (dropped[priority] || 0) + 1;
+    }
+
+    /**
+     * Keep a message sent during an outage. Returns false if it should be sent anyway.
+     */
+    bufferOutbound(msg, length, andruav_message_id) {
+        if (andruav_message_id === undefined) {
+            return false;
+        }
+        const priority = this.m_outage_priorities.has(andruav_message_id) ? this.m_outage_priorities.get(andruav_message_id) : OUTAGE_PRIORITY_NORMAL;
+        if (priority === OUTAGE_PRIORITY_DROP || length > this.m_outage_max_bytes || this.m_outage_max_messages <= 0) {
+            this.countOutageDrop(priority);
+            return true;
+        }
+
+        while ((this.m_outage_buffer_count >= this.m_outage_max_messages)
+            || (this.m_outage_buffer_bytes + length > this.m_outage_max_bytes)) {
+            // oldest message of the lowest priority not above the new one.
+            let victims = null;
+            let victimPriority;
+            for (const [bufferedPriority, queue] of this.m_outage_buffer) {
+                if (bufferedPriority <= priority && queue.head < queue.entries.length
+                    && (victims === null || bufferedPriority < victimPriority)) {
+                    victims = queue;
+                    victimPriority = bufferedPriority;
+                }
+            }
+            if (victims === null) {
+                this.countOutageDrop(priority);
+                return true;
+            }
+            const removed = victims.entries[victims.head++];
+            if (victims.head === victims.entries.length) {
+                victims.entries = [];
+                victims.head = 0;
+            }
+            this.m_outage_buffer_count -= 1;
+            this.m_outage_buffer_bytes -= removed.length;
+            this.countOutageDrop(victimPriority);
+        }
+
+        if (!this.m_outage_buffer.has(priority)) {
+            this.m_outage_buffer.set(priority, { entries: [], head: 0 });
+        }
+        this.m_outage_buffer.get(priority).entries.push({ sequence: this.m_outage_sequence++, msg: msg, length: length });
+        this.m_outage_buffer_count += 1;
+        this.m_outage_buffer_bytes += length;
+        return true;
+    }
+
+    /**
+     * Queue the outage buffer on the transport in the order it was sent, whatever the priority.
+     * The transport sends one message at a time, so messages sent later go out after it.
+     */
+    flushOutbound() {
+        const pending = [];
+        for (const queue of this.m_outage_buffer.values()) {
+            for (let i = queue.head; i < queue.entries.length; i++) {
+                pending.push(queue.entries[i]);
+            }
+        }
+        pending.sort((a, b) => a.sequence - b.sequence);
+        this.m_outage_buffer.clear();
+        this.m_outage_buffer_count = 0;
+        this.m_outage_buffer_bytes = 0;
+        this.m_outage_stats.flushed += pending.length;
+        for (const entry of pending) {
+            this.cUDPClient.sendMSG(entry.msg, entry.length);
+        }
+    }
+
+    /**
+     * Called before each ID message: detect outages and back the heartbeat off while stable.
+     * de_comm only replies to IDs that ask for it (JSON_INTERMODULE_RESEND). A link silent for
+     * half the deadline is probed with those, and is lost only if no probe gets a reply.
+     */
+    onLinkTick() {
+        if (!this.m_link_connected) {
+            return;
+        }
+        const silent = Date.now() - this.m_last_received;
+        if (silent > this.m_liveness_deadline) {
+            this.m_link_connected = false;
+            console.log(` ** Communicator Server Lost: no message for ${this.m_liveness_deadline}ms`);
+            this.m_FirstReceived = false;
+            this.m_link_probing = false;
+            this.createJSONID(true);
+            this.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL);
+            return;
+        }
+        if (silent > this.m_liveness_deadline / 2) {
+            if (!this.m_link_probing) {
+                this.m_link_probing = true;
+                this.createJSONID(true);
+                this.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL);
+            }
+            return;
+        }
+        if (this.m_link_probing) {
+            this.m_link_probing = false;
+            this.createJSONID(false);
+        }
+        this.m_heartbeat_interval = Math.min(this.m_heartbeat_interval * 2, LINK_HEARTBEAT_INTERVAL_MAX,
+                                             this.m_liveness_deadline / 2);
+        // the next ID goes out no later than when probing should start.
+        this.cUDPClient.setIdInterval(Math.max(LINK_ID_RETRY_INTERVAL,
+                                               Math.min(this.m_heartbeat_interval, this.m_liveness_deadline / 2 - silent)));
+    }
+
     sendSysMsg(jmsg, andruav_message_id) {
         const full_message = {
             [ANDRUAV_PROTOCOL_TARGET_ID]: SPECIAL_NAME_SYS_NAME,
@@ -82,7 +460,10 @@ class CModule extends EventEmitter {
         this.sendMSG(Buffer.from(msg), msg.length);
     }
 
-    sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message) {
+    /**
+     * @param {string} [correlation_id] stamped into the envelope so a reply can be matched to its request.
+     */
+    sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message, correlation_id) {
         this.m_lock.acquire('lock', (done) => {
             const fullMessage = {};
             let msg_routing_type = CMD_COMM_GROUP;
@@ -98,14 +479,97 @@ class CModule extends EventEmitter {
             fullMessage[INTERMODULE_ROUTING_TYPE] = msg_routing_type;
             fullMessage[ANDRUAV_PROTOCOL_MESSAGE_TYPE] = andruav_message_id;
             fullMessage[ANDRUAV_PROTOCOL_MESSAGE_CMD] = jmsg;
+            if (correlation_id !== undefined && correlation_id !== null) {
+                fullMessage[ANDRUAV_PROTOCOL_CORRELATION_ID] = correlation_id;
+            }
 
             const msg = JSON.stringify(fullMessage);
             console.log(`sendJMSG: ${msg}`);
-            this.sendMSG(Buffer.from(msg), msg.length);
+            this.sendMSG(Buffer.from(msg), msg.length, andruav_message_id);
             done();
         });
     }
 
+    /**
+     * Send a JSON request and return a Promise resolved with the reply message.
+     *
+     * The reply is matched in onReceive by the correlation id echoed back by the
+     * replying module (see replyJMSG). Modules that do not echo the id can still be
+     * matched through options.replyMessageId: the oldest pending request for that
+     * reply type from targetPartyID is resolved. The promise rejects on timeout and
+     * when uninit() cancels the request.
+     *
+     * @param {Object} [options] { timeout (ms), replyMessageId, internalMessage, callback(jMsg, error) }
+     */
+    request(targetPartyID, jmsg, andruav_message_id, options = {}) {
+        const timeout = options.timeout !== undefined ? options.timeout : DEFAULT_REQUEST_TIMEOUT;
+        this.m_request_counter += 1;
+        const correlation_id = `${this.m_module_key}:${this.m_request_counter}`;
+
+        const promise = new Promise((resolve, reject) => {
+            const request = {
+                targetPartyID: targetPartyID,
+                replyMessageId: options.replyMessageId,
+                resolve: resolve,
+                reject: reject,
+                timer: null
+            };
+            request.timer = this.m_timer_wheel.schedule(timeout, () => {
+                if (this.m_pending_requests.delete(correlation_id)) {
+                    reject(new Error(`request ${correlation_id} timed out`));
+                }
+            });
+            this.m_pending_requests.set(correlation_id, request);
+        });
+
+        if (options.callback) {
+            promise.then((jMsg) => options.callback(jMsg, null), (error) => options.callback(null, error));
+        }
+
+        this.sendJMSG(targetPartyID, jmsg, andruav_message_id, options.internalMessage === true, correlation_id);
+        return promise;
+    }
+
+    /**
+     * Reply to a received request, echoing its correlation id back to the sender.
+     */
+    replyJMSG(requestJMsg, jmsg, andruav_message_id, internal_message = false) {
+        const targetPartyID = requestJMsg[ANDRUAV_PROTOCOL_SENDER] || "";
+        this.sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message, requestJMsg[ANDRUAV_PROTOCOL_CORRELATION_ID]);
+    }
+
+    matchReply(jMsg) {
+        if (this.m_pending_requests.size === 0) {
+            return false;
+        }
+
+        let key = null;
+        const correlation_id = jMsg[ANDRUAV_PROTOCOL_CORRELATION_ID];
+        if (correlation_id !== undefined) {
+            if (this.m_pending_requests.has(correlation_id)) {
+                key = correlation_id;
+            }
+        } else {
+            const messageType = jMsg[ANDRUAV_PROTOCOL_MESSAGE_TYPE];
+            const sender = jMsg[ANDRUAV_PROTOCOL_SENDER] || "";
+            for (const [id, pending] of this.m_pending_requests) {
+                if (pending.replyMessageId !== messageType) continue;
+                if (pending.targetPartyID && pending.targetPartyID !== sender) continue;
+                key = id;
+                break;
+            }
+        }
+        if (key === null) {
+            return false;
+        }
+
+        const request = this.m_pending_requests.get(key);
+        this.m_pending_requests.delete(key);
+        request.timer.cancel();
+        request.resolve(jMsg);
+        return true;
+    }
+
     sendBMSG(targetPartyID, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd) {
         this.m_lock.acquire('lock', (done) => {
             const fullMessage = {};
@@ -130,22 +594,106 @@ class CModule extends EventEmitter {
                 msg = Buffer.concat([msg, bmsg]);
             }
 
-            this.sendMSG(msg, msg.length);
+            this.sendMSG(msg, msg.length, andruav_message_id);
             done();
         });
     }
 
+    /**
+     * Envelope text up to the body, for one target.
+     */
+    fanOutHead(targetPartyID, andruav_message_id, internal_message) {
+        let msg_routing_type = CMD_COMM_GROUP;
+        if (internal_message) {
+            msg_routing_type = CMD_TYPE_INTERMODULE;
+        } else if (targetPartyID) {
+            msg_routing_type = CMD_COMM_INDIVIDUAL;
+        }
+
+        const envelope = JSON.stringify({
+            [JSON_INTERMODULE_MODULE_KEY]: this.m_module_key,
+            [ANDRUAV_PROTOCOL_TARGET_ID]: targetPartyID,
+            [INTERMODULE_ROUTING_TYPE]: msg_routing_type,
+            [ANDRUAV_PROTOCOL_MESSAGE_TYPE]: andruav_message_id
+        });
+        return Buffer.from(`${envelope.slice(0, -1)},"${ANDRUAV_PROTOCOL_MESSAGE_CMD}":`);
+    }
+
+    sendFanOut(targetPartyIDs, tail, andruav_message_id, internal_message) {
+        const heads = targetPartyIDs.map(target => this.fanOutHead(target, andruav_message_id, internal_message));
+        if (!this.m_link_connected) {
+            // buffered one by one during an outage.
+            for (const head of heads) {
+                const msg = Buffer.concat([head, tail]);
+                this.sendMSG(msg, msg.length, andruav_message_id);
+            }
+            return;
+        }
+        this.cUDPClient.sendFanOut(heads, tail);
+    }
+
+    /**
+     * sendJMSG() to each of targetPartyIDs. The body is serialized and chunked once,
+     * only the first chunk, which holds the routing header, is built per target.
+     */
+    sendJMSGMulti(targetPartyIDs, jmsg, andruav_message_id, internal_message = false) {
+        this.m_lock.acquire('lock', (done) => {
+            const tail = Buffer.from(JSON.stringify(jmsg) + '}');
+            this.sendFanOut(targetPartyIDs, tail, andruav_message_id, internal_message);
+            done();
+        });
+    }
+
+    /**
+     * sendBMSG() to each of targetPartyIDs, the binary payload is chunked once.
+     */
+    sendBMSGMulti(targetPartyIDs, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd) {
+        this.m_lock.acquire('lock', (done) => {
+            let tail = Buffer.from(JSON.stringify(message_cmd) + '}\0');
+            if (bmsg_length) {
+                tail = Buffer.concat([tail, bmsg]);
+            }
+            this.sendFanOut(targetPartyIDs, tail, andruav_message_id, internal_message);
+            done();
+        });
+    }
+
+    /**
+     * Call producer() rate times per second, e.g. to send a telemetry stream.
+     * Producers run on drift free deadlines from one timer; producers with the same
+     * rate share a wakeup. They start once the module is initialized.
+     * Returns an id for setPublisherRate(), getPublisherStats() and removePeriodicPublisher().
+     */
+    addPeriodicPublisher(rate, producer) {
+        return this.m_publisher.addPublisher(rate, producer);
+    }
+
+    removePeriodicPublisher(publisherId) {
+        return this.m_publisher.removePublisher(publisherId);
+    }
+
+    setPublisherRate(publisherId, rate) {
+        return this.m_publisher.setRate(publisherId, rate);
+    }
+
+    /**
+     * rate, runs, overruns (skipped periods) and jitterLast/Max/Mean in ms.
+     */
+    getPublisherStats(publisherId) {
+        return this.m_publisher.getStats(publisherId);
+    }
+
     sendMREMSG(command_type) {
         this.m_lock.acquire('lock', (done) => {
             const json_msg = {
                 [JSON_INTERMODULE_MODULE_KEY]: this.m_module_key,
                 [INTERMODULE_ROUTING_TYPE]: CMD_TYPE_INTERMODULE,
-                [ANDRUAV_PROTOCOL_MESSAGE_TYPE]: "TYPE_AndruavModule_RemoteExecute",
+                [ANDRUAV_PROTOCOL_MESSAGE_TYPE]: TYPE_AndruavModule_RemoteExecute,
                 [ANDRUAV_PROTOCOL_MESSAGE_CMD]: { "C": command_type }
             };
 
             const msg = JSON.stringify(json_msg);
-            this.sendMSG(Buffer.from(msg), msg.length);
+            this.sendMSG(Buffer.from(msg), msg.length, TYPE_AndruavModule_RemoteExecute);
             done();
         });
     }
@@ -154,6 +702,156 @@ class CModule extends EventEmitter {
         this.sendMSG(message, datalength);
     }
 
+    /**
+     * Relay received messages of messageTypes and/or addressed to targetPartyID.
+     * Matching messages are retransmitted chunk by chunk as they arrive, without waiting
+     * for the whole message, and are not delivered to m_OnReceive.
+     * @param {object} rule
+     * @param {number[]} [rule.messageTypes]
+     * @param {string} [rule.targetPartyID]
+     * @param {CTransport} [rule.transport] where to relay, this module's own transport (de_comm) by default
+     * @param {function} [rule.rewrite] rewrite(jHeader) returns the envelope to send instead, e.g. with another target
+     * @returns {number} rule id for removeForwardingRule()
+     */
+    addForwardingRule({ messageTypes = null, targetPartyID = null, transport = null, rewrite = null } = {}) {
+        this.m_forwarding_rule_counter += 1;
+        this.m_forwarding_rules.set(this.m_forwarding_rule_counter, {
+            messageTypes: messageTypes ? new Set(messageTypes) : null,
+            targetPartyID,
+            transport,
+            rewrite
+        });
+        return this.m_forwarding_rule_counter;
+    }
+
+    removeForwardingRule(ruleId) {
+        this.m_forwarding_rules.delete(ruleId);
+    }
+
+    /**
+     * { cut_through, stored } messages relayed chunk by chunk, or after reassembly
+     * because their envelope did not fit in the first chunk.
+     */
+    getForwardingStats() {
+        return { ...this.m_forward_stats };
+    }
+
+    matchForwardingRule(jHeader) {
+        if (jHeader[INTERMODULE_ROUTING_TYPE] === CMD_TYPE_INTERMODULE) {
+            return null;
+        }
+        for (const rule of this.m_forwarding_rules.values()) {
+            if (rule.messageTypes && !rule.messageTypes.has(jHeader[ANDRUAV_PROTOCOL_MESSAGE_TYPE])) {
+                continue;
+            }
+            if (rule.targetPartyID !== null && jHeader[ANDRUAV_PROTOCOL_TARGET_ID] !== rule.targetPartyID) {
+                continue;
+            }
+            return rule;
+        }
+        return null;
+    }
+
+    /**
+     * Parse the JSON envelope at data[offset:] up to the binary separator.
+     * Returns { jHeader, end } or null if the envelope is not all in data.
+     */
+    static splitEnvelope(data, offset, complete) {
+        let end = data.indexOf(0, offset);
+        if (end === -1) {
+            if (!complete) {
+                return null;
+            }
+            end = data.length;
+        }
+        try {
+            return { jHeader: JSON.parse(data.toString('utf8', offset, end)), end };
+        } catch (e) {
+            return null;
+        }
+    }
+
+    /**
+     * Envelope to relay: rewritten by the rule, sent with this module's key.
+     */
+    rewriteEnvelope(rule, data, offset, envelope) {
+        let jHeader = envelope.jHeader;
+        if (rule.rewrite) {
+            jHeader = rule.rewrite(jHeader);
+        } else if (jHeader[INTERMODULE_MODULE_KEY] === this.m_module_key) {
+            return data;
+        }
+        jHeader[INTERMODULE_MODULE_KEY] = this.m_module_key;
+        const header = Buffer.from(JSON.stringify(jHeader));
+        return Buffer.concat([data.subarray(0, offset), header, data.subarray(envelope.end)]);
+    }
+
+    /**
+     * True if a last chunk holds a whole message of its own rather than a tail.
+     */
+    static isEnvelope(datagram) {
+        if (datagram[UDP_CHUNK_HEADER_SIZE] !== 0x7B) {   // '{'
+            return false;
+        }
+        const envelope = CModule.splitEnvelope(datagram, UDP_CHUNK_HEADER_SIZE, true);
+        return envelope !== null && typeof envelope.jHeader === 'object' && envelope.jHeader !== null
+            && ANDRUAV_PROTOCOL_MESSAGE_TYPE in envelope.jHeader;
+    }
+
+    /**
+     * Transport hook: relays chunks of messages that match a forwarding rule.
+     */
+    onChunk(datagram, chunkNumber, first) {
+        if (this.m_forward_rule) {
+            const transport = this.m_forward_rule.transport || this.cUDPClient;
+            if (chunkNumber === 0 || !transport.isForwarding()
+                || (chunkNumber === UDP_LAST_CHUNK_NUMBER && CModule.isEnvelope(datagram))) {
+                // the relayed message lost its tail: a new message started or the relay timed out.
+                this.m_forward_rule = null;
+                transport.endForwardSession();
+            } else {
+                transport.forwardDatagram(datagram, false);
+                if (chunkNumber === UDP_LAST_CHUNK_NUMBER) {
+                    this.m_forward_rule = null;
+                }
+                return true;
+            }
+        }
+
+        if (this.m_forwarding_rules.size === 0 || !first || (chunkNumber !== 0 && chunkNumber !== UDP_LAST_CHUNK_NUMBER)) {
+            return false;
+        }
+
+        const last = chunkNumber === UDP_LAST_CHUNK_NUMBER;
+        const envelope = CModule.splitEnvelope(datagram, UDP_CHUNK_HEADER_SIZE, last);
+        if (!envelope) {
+            // envelope continues in the next chunk, onReceive() forwards it after reassembly.
+            return false;
+        }
+        const rule = this.matchForwardingRule(envelope.jHeader);
+        if (!rule) {
+            return false;
+        }
+
+        (rule.transport || this.cUDPClient).forwardDatagram(this.rewriteEnvelope(rule, datagram, UDP_CHUNK_HEADER_SIZE, envelope), true);
+        if (!last) {
+            this.m_forward_rule = rule;
+        }
+        this.m_forward_stats.cut_through += 1;
+        return true;
+    }
+
+    forwardReassembled(message, jMsg) {
+        const rule = this.matchForwardingRule(jMsg);
+        if (!rule) {
+            return false;
+        }
+        message = this.rewriteEnvelope(rule, message, 0, CModule.splitEnvelope(message, 0, true));
+        (rule.transport || this.cUDPClient).sendMSG(message, message.length);
+        this.m_forward_stats.stored += 1;
+        return true;
+    }
+
     onReceive(message, len) {
         console.log(`RX MSG: len ${len}: ${message}`);
 
@@ -162,6 +860,8 @@ class CModule extends EventEmitter {
 
             console.log(`RX MSG: jMsg ${JSON.stringify(jMsg)}`);
 
+            this.m_last_received = Date.now();
+
             if (!(ANDRUAV_PROTOCOL_MESSAGE_TYPE in jMsg) || !(INTERMODULE_ROUTING_TYPE in jMsg)) {
                 return;
             }
@@ -183,10 +883,18 @@ class CModule extends EventEmitter {
                     this.m_party_id = moduleID[ANDRUAV_PROTOCOL_SENDER];
                     this.m_group_id = moduleID[ANDRUAV_PROTOCOL_GROUP_ID];
 
+                    if (JSON_INTERMODULE_CHUNK_SIZE in cmd) {
+                        this.cUDPClient.negotiateChunkSize(parseInt(cmd[JSON_INTERMODULE_CHUNK_SIZE]));
+                    }
+
                     if (!this.m_FirstReceived) {
                         console.log(` ** Communicator Server Found: m_party_id(${this.m_party_id}) m_group_id(${this.m_group_id})`);
                         this.createJSONID(false);
                         this.m_FirstReceived = true;
+                        this.m_heartbeat_interval = LINK_HEARTBEAT_INTERVAL_MIN;
+                        this.cUDPClient.setIdInterval(this.m_heartbeat_interval);
+                        this.m_link_connected = true;
+                        this.flushOutbound();
                     }
 
                     if (this.m_OnReceive) {
@@ -198,10 +906,16 @@ class CModule extends EventEmitter {
                 }
             }
 
-            if (this.m_OnReceive) {
-                this.m_OnReceive(message, len, jMsg);
+            if (this.m_forwarding_rules.size > 0 && this.forwardReassembled(message, jMsg)) {
+                return;
+            }
+
+            if (this.matchReply(jMsg)) {
+                return;
             }
 
+            this.dispatch(message, len, jMsg);
+
         } catch (e) {
             console.error(`ERROR: ${e}`);
         }
@@ -226,7 +940,8 @@ class CModule extends EventEmitter {
             [JSON_INTERMODULE_HARDWARE_TYPE]: this.m_hardware_serial_type,
             [JSON_INTERMODULE_VERSION]: this.m_module_version,
             [JSON_INTERMODULE_RESEND]: reSend,
-            [JSON_INTERMODULE_TIMESTAMP_INSTANCE]: this.m_instance_time_stamp
+            [JSON_INTERMODULE_TIMESTAMP_INSTANCE]: this.m_instance_time_stamp,
+            [JSON_INTERMODULE_CHUNK_SIZE]: this.cUDPClient.localChunkSize
         };
 
         for (const [key, value] of Object.entries(this.m_stdinValues)) {
@@ -240,3 +955,10 @@ class CModule extends EventEmitter {
 }
 
 module.exports = CModule;
+module.exports.DELIVERY_POLICY_NONE = DELIVERY_POLICY_NONE;
+module.exports.DELIVERY_POLICY_CONFLATE = DELIVERY_POLICY_CONFLATE;
+module.exports.DELIVERY_POLICY_TTL = DELIVERY_POLICY_TTL;
+module.exports.OUTAGE_PRIORITY_DROP = OUTAGE_PRIORITY_DROP;
+module.exports.OUTAGE_PRIORITY_LOW = OUTAGE_PRIORITY_LOW;
+module.exports.OUTAGE_PRIORITY_NORMAL = OUTAGE_PRIORITY_NORMAL;
+module.exports.OUTAGE_PRIORITY_HIGH = OUTAGE_PRIORITY_HIGH;
@@ -0,0 +1,259 @@
+/**
+ * ffi binding (koffi) for the native DroneEngage databus library (client/src/de_capi).
+ * Drop-in alternative to CModule that uses the C++ chunking, pacing and
+ * reassembly engine instead of the pure JavaScript transport in udpClient.js.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const { UDP_DATABUS_PACKET_SIZE_AUTO } = require('./transport');
+
+const DE_CAPI_OK = 0;
+
+function findLibrary() {
+    if (process.env.DE_DATABUS_LIBRARY) {
+        return process.env.DE_DATABUS_LIBRARY;
+    }
+    const local = path.join(__dirname, '..', 'client', 'bin', 'libdroneengage_databus.so');
+    if (fs.existsSync(local)) {
+        return local;
+    }
+    return 'libdroneengage_databus.so';
+}
+
+/**
+ * A received message owning one reference to the library's pooled buffer.
+ *
+ * header, payload and data are Buffers over the native memory, nothing is copied.
+ * A Buffer keeps its message alive, but release() frees the memory under it: do not call
+ * release() while Buffers are in use. Messages that are dropped without release() are
+ * released by the garbage collector.
+ */
+class CNativeMessage {
+    constructor(module, handle) {
+        this.module = module;
+        this.handle = handle;
+        this.parsedBody = undefined;
+        CNativeMessage.finalizer.register(this, { module, handle }, this);
+    }
+
+    view(accessor) {
+        if (!this.handle) {
+            throw new Error('message released');
+        }
+        const len = [0];
+        const address = accessor(this.handle, len);
+        if (len[0] === 0) {
+            return Buffer.alloc(0);
+        }
+        const koffi = this.module.koffi;
+        if (typeof koffi.view === 'function') {
+            const memory = koffi.view(address, len[0]);
+            // the Buffer and its slices hold the ArrayBuffer, which keeps the message,
+            // and so the pooled buffer, from being collected.
+            Object.defineProperty(memory, 'owner', { value: this });
+            return Buffer.from(memory);
+        }
+        // older koffi cannot view native memory, copy.
+        return Buffer.from(koffi.decode(address, 'uint8_t', len[0]));
+    }
+
+    get data() {
+        return this.view(this.module.native.messageData);
+    }
+
+    /**
+     * The JSON envelope, without the '\0' separator.
+     */
+    get header() {
+        return this.view(this.module.native.messageHeader);
+    }
+
+    /**
+     * The binary payload, empty for JSON only messages.
+     */
+    get payload() {
+        return this.view(this.module.native.messagePayload);
+    }
+
+    /**
+     * The parsed envelope, parsed on first access.
+     */
+    get body() {
+        if (this.parsedBody === undefined) {
+            this.parsedBody = JSON.parse(this.header.toString());
+        }
+        return this.parsedBody;
+    }
+
+    messageType() {
+        return this.handle ? this.module.native.messageType(this.handle) : -1;
+    }
+
+    /**
+     * Another, independently released, reference to the same buffer.
+     */
+    retain() {
+        if (!this.handle) {
+            throw new Error('message released');
+        }
+        return new CNativeMessage(this.module, this.module.native.messageRetain(this.handle));
+    }
+
+    /**
+     * Return the buffer to the pool once all references are released.
+     */
+    release() {
+        if (this.handle) {
+            CNativeMessage.finalizer.unregister(this);
+            this.module.native.messageRelease(this.handle);
+            this.handle = null;
+        }
+    }
+}
+
+CNativeMessage.finalizer = new FinalizationRegistry(({ module, handle }) => module.native.messageRelease(handle));
+
+class CNativeModule {
+    constructor(libraryPath) {
+        if (CNativeModule._instance) {
+            return CNativeModule._instance;
+        }
+        CNativeModule._instance = this;
+
+        // optional dependency, only needed when the native library is used.
+        this.koffi = require('koffi');
+        const lib = this.koffi.load(libraryPath || findLibrary());
+
+        this.OnReceiveProto = this.koffi.proto('void de_on_receive_t(const uint8_t *message, int len, void *user_data)');
+        this.OnMessageProto = this.koffi.proto('void de_on_message_t(void *message, void *user_data)');
+        this.native = {
+            define: lib.func('int de_module_define(const char *module_class, const char *module_id, const char *module_key, const char *module_version, const char *message_filter_json)'),
+            addFeature: lib.func('int de_module_add_feature(const char *feature)'),
+            setHardware: lib.func('int de_module_set_hardware(const char *hardware_serial, int hardware_type)'),
+            setOnReceive: lib.func('int de_module_set_on_receive(de_on_receive_t *callback, void *user_data)'),
+            setOnMessage: lib.func('int de_module_set_on_message(de_on_message_t *callback, void *user_data)'),
+            messageRetain: lib.func('void *de_message_retain(void *message)'),
+            messageRelease: lib.func('void de_message_release(void *message)'),
+            messageData: lib.func('const void *de_message_data(void *message, _Out_ int *len)'),
+            messageHeader: lib.func('const void *de_message_header(void *message, _Out_ int *len)'),
+            messagePayload: lib.func('const void *de_message_payload(void *message, _Out_ int *len)'),
+            messageType: lib.func('int de_message_type(void *message)'),
+            init: lib.func('int de_module_init(const char *target_ip, int target_port, const char *host, int listen_port, int chunk_size)'),
+            uninit: lib.func('int de_module_uninit()'),
+            sendJMSG: lib.func('int de_module_send_jmsg(const char *target_party_id, const char *json_msg, int message_type, int internal_message)'),
+            sendBMSG: lib.func('int de_module_send_bmsg(const char *target_party_id, const uint8_t *data, int len, int message_type, int internal_message, const char *json_cmd)')
+        };
+
+        this.m_OnReceive = null;
+        this.m_OnReceiveEx = null;
+        this.m_nativeCallback = null;
+        this.m_nativeMessageCallback = null;
+        return CNativeModule._instance;
+    }
+
+    defineModule(module_class, module_id, module_key, module_version, message_filter) {
+        this.check(this.native.define(module_class, module_id, module_key, module_version, JSON.stringify(message_filter)));
+    }
+
+    addModuleFeatures(feature) {
+        this.check(this.native.addFeature(feature));
+    }
+
+    setHardware(hardware_serial, hardware_serial_type) {
+        this.check(this.native.setHardware(hardware_serial, hardware_serial_type));
+    }
+
+    /**
+     * callback(message: Buffer, length, jMsg). The library calls it from its receiver
+     * thread; koffi marshals the call onto the JavaScript thread.
+     */
+    setMessageOnReceive(callback) {
+        this.m_OnReceive = callback;
+        if (!this.m_nativeCallback) {
+            this.m_nativeCallback = this.koffi.register((message, len) => this.onNativeReceive(message, len),
+                                                        this.koffi.pointer(this.OnReceiveProto));
+        }
+        this.check(this.native.setOnReceive(this.m_nativeCallback, null));
+    }
+
+    /**
+     * callback(message: CNativeMessage) receives an owned message instead of a copy.
+     * The message can be kept or queued; its buffer returns to the library's pool
+     * when it is released or garbage collected.
+     */
+    setMessageOnReceiveEx(callback) {
+        this.m_OnReceiveEx = callback;
+        if (!this.m_nativeMessageCallback) {
+            this.m_nativeMessageCallback = this.koffi.register((message) => this.onNativeMessage(message),
+                                                               this.koffi.pointer(this.OnMessageProto));
+        }
+        this.check(this.native.setOnMessage(this.m_nativeMessageCallback, null));
+    }
+
+    init(target_ip, broadcasts_port, host, listening_port, chunk_size = UDP_DATABUS_PACKET_SIZE_AUTO) {
+        this.check(this.native.init(target_ip, broadcasts_port, host, listening_port, chunk_size));
+        return true;
+    }
+
+    uninit() {
+        this.check(this.native.uninit());
+        // the library must not keep pointers to the trampolines freed below.
+        this.check(this.native.setOnReceive(null, null));
+        this.check(this.native.setOnMessage(null, null));
+        if (this.m_nativeCallback) {
+            this.koffi.unregister(this.m_nativeCallback);
+            this.m_nativeCallback = null;
+        }
+        if (this.m_nativeMessageCallback) {
+            this.koffi.unregister(this.m_nativeMessageCallback);
+            this.m_nativeMessageCallback = null;
+        }
+        return true;
+    }
+
+    sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message) {
+        this.check(this.native.sendJMSG(targetPartyID, JSON.stringify(jmsg), andruav_message_id, internal_message ? 1 : 0));
+    }
+
+    sendBMSG(targetPartyID, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd) {
+        this.check(this.native.sendBMSG(targetPartyID, bmsg, bmsg_length, andruav_message_id, internal_message ? 1 : 0, JSON.stringify(message_cmd)));
+    }
+
+    onNativeReceive(message, len) {
+        if (!this.m_OnReceive) {
+            return;
+        }
+        try {
+            // copy out, the native buffer is only valid during the call.
+            const data = Buffer.from(this.koffi.decode(message, 'uint8_t', len));
+            const headerEnd = data.indexOf(0);
+            const header = headerEnd === -1 ? data : data.subarray(0, headerEnd);
+            this.m_OnReceive(data, len, JSON.parse(header.toString()));
+        } catch (e) {
+            console.error(`ERROR: ${e}`);
+        }
+    }
+
+    onNativeMessage(handle) {
+        const message = new CNativeMessage(this, handle);
+        if (!this.m_OnReceiveEx) {
+            message.release();
+            return;
+        }
+        try {
+            this.m_OnReceiveEx(message);
+        } catch (e) {
+            console.error(`ERROR: ${e}`);
+        }
+    }
+
+    check(result) {
+        if (result !== DE_CAPI_OK) {
+            throw new Error(`de_capi call failed (${result})`);
+        }
+    }
+}
+
+module.exports = CNativeModule;
+module.exports.CNativeMessage = CNativeMessage;
@@ -0,0 +1,100 @@
+const CTransport = require('./transport');
+const { UDP_MAX_DATAGRAM_SIZE, UDP_CHUNK_HEADER_SIZE } = require('./transport');
+
+/**
+ * In-process datagram network connecting CMemoryTransport endpoints.
+ * Endpoints are addressed by port only, so "0.0.0.0", "127.0.0.1" and any other
+ * host name reach the same endpoint. Datagrams sent to a port nobody listens on
+ * are dropped, like UDP.
+ */
+class CMemoryNetwork {
+    constructor() {
+        this.endpoints = new Map();
+        this.stats = { delivered: 0, unreachable: 0 };
+        // delivered datagrams whose receiver has not run yet.
+        this.pending = 0;
+    }
+
+    attach(port, onDatagram) {
+        if (this.endpoints.has(port)) {
+            throw new Error(`Port ${port} already in use`);
+        }
+        this.endpoints.set(port, onDatagram);
+    }
+
+    detach(port) {
+        this.endpoints.delete(port);
+    }
+
+    /**
+     * Delivered on a later turn of the event loop, as a socket would.
+     */
+    deliver(address, datagram) {
+        const onDatagram = this.endpoints.get(address.port);
+        if (!onDatagram) {
+            this.stats.unreachable += 1;
+            return false;
+        }
+        this.stats.delivered += 1;
+        const copy = Buffer.from(datagram);
+        this.pending += 1;
+        setImmediate(() => {
+            this.pending -= 1;
+            if (this.endpoints.get(address.port) === onDatagram) {
+                onDatagram(copy);
+            }
+        });
+        return true;
+    }
+
+    /**
+     * Resolves once every datagram delivered so far has been processed by its receiver,
+     * including the datagrams those receivers sent in turn.
+     */
+    async waitIdle() {
+        do {
+            await new Promise(resolve => setImmediate(resolve));
+        } while (this.pending > 0);
+    }
+
+    getStats() {
+        return { ...this.stats };
+    }
+}
+
+/**
+ * CTransport over a CMemoryNetwork. Connects modules inside one process without sockets.
+ * Chunks are not paced by default, the network never loses them.
+ */
+class CMemoryTransport extends CTransport {
+    constructor(network) {
+        super();
+        this.network = network;
+        this.attached = false;
+        this.chunkPacing = 0;
+    }
+
+    detectChunkSize(targetIP) {
+        return UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE;
+    }
+
+    open(onDatagram) {
+        this.network.attach(this.moduleAddress.port, onDatagram);
+        this.attached = true;
+    }
+
+    close() {
+        if (this.attached) {
+            this.network.detach(this.moduleAddress.port);
+            this.attached = false;
+        }
+    }
+
+    sendDatagram(datagram) {
+        this.network.deliver(this.communicatorModuleAddress, datagram);
+    }
+}
+
+module.exports = CMemoryTransport;
+module.exports.CMemoryNetwork = CMemoryNetwork;
+module.exports.CMemoryTransport = CMemoryTransport;
@@ -14,6 +14,7 @@ const JSON_INTERMODULE_HARDWARE_TYPE = "t";
 const JSON_INTERMODULE_VERSION = "v";
 const JSON_INTERMODULE_TIMESTAMP_INSTANCE = "u";
 const JSON_INTERMODULE_RESEND = "z";
+const JSON_INTERMODULE_CHUNK_SIZE = "k";
 
 // Communication Commands
 const CMD_COMM_GROUP = "g";
@@ -29,6 +30,7 @@ const ANDRUAV_PROTOCOL_MESSAGE_CMD = "ms";
 const ANDRUAV_PROTOCOL_MESSAGE_PERMISSION = "p";
 const INTERMODULE_ROUTING_TYPE = "ty";
 const INTERMODULE_MODULE_KEY = "GU";
+const ANDRUAV_PROTOCOL_CORRELATION_ID = "ci";
 
 // Reserved Target Values
 const ANDRUAV_PROTOCOL_SENDER_ALL_GCS = "_GCS_";
@@ -186,6 +188,7 @@ module.exports = {
     JSON_INTERMODULE_VERSION,
     JSON_INTERMODULE_TIMESTAMP_INSTANCE,
     JSON_INTERMODULE_RESEND,
+    JSON_INTERMODULE_CHUNK_SIZE,
     CMD_COMM_GROUP,
     CMD_COMM_INDIVIDUAL,
     CMD_COMM_SYSTEM,
@@ -197,6 +200,7 @@ module.exports = {
     ANDRUAV_PROTOCOL_MESSAGE_PERMISSION,
     INTERMODULE_ROUTING_TYPE,
     INTERMODULE_MODULE_KEY,
+    ANDRUAV_PROTOCOL_CORRELATION_ID,
     ANDRUAV_PROTOCOL_SENDER_ALL_GCS,
     ANDRUAV_PROTOCOL_SENDER_ALL_AGENTS,
     ANDRUAV_PROTOCOL_SENDER_ALL,
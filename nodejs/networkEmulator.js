@@ -0,0 +1,214 @@
+const CTransport = require('./transport');
+
+const NETWORK_IMPAIRMENTS = ['loss', 'duplicate', 'reorder', 'reorderDelay', 'delay', 'jitter', 'rate', 'queueBytes'];
+
+/**
+ * Small seedable generator (mulberry32), Math.random() cannot be seeded.
+ */
+function createRandom(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (state + 0x6D2B79F5) >>> 0;
+        let t = state;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+/**
+ * Simulated time for CNetworkEmulator, in ms from 0.
+ *
+ * Time only moves when advance() is called. Datagrams are then delivered in the
+ * order of their arrival times, so the delivery order depends on the seed and the
+ * sequence of sends, never on timer scheduling.
+ */
+class CVirtualClock {
+    constructor() {
+        this.time = 0;
+        // sorted by time, then by scheduling order.
+        this.events = [];
+        this.sequence = 0;
+    }
+
+    now() {
+        return this.time;
+    }
+
+    /**
+     * callback() runs inside the advance() call that reaches when.
+     */
+    schedule(when, callback) {
+        const event = { when, sequence: ++this.sequence, callback };
+        let low = 0;
+        let high = this.events.length;
+        while (low < high) {
+            const middle = (low + high) >>> 1;
+            if (this.events[middle].when <= when) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        this.events.splice(low, 0, event);
+    }
+
+    /**
+     * Time of the earliest scheduled callback, null if there is none.
+     */
+    nextEventTime() {
+        return this.events.length > 0 ? this.events[0].when : null;
+    }
+
+    /**
+     * Move time forward, running the callbacks due on the way in time order.
+     */
+    advance(ms) {
+        const target = this.time + ms;
+        while (this.events.length > 0 && this.events[0].when <= target) {
+            const event = this.events.shift();
+            this.time = Math.max(this.time, event.when);
+            event.callback();
+        }
+        this.time = target;
+    }
+}
+
+/**
+ * Decorates a CTransport with network impairments on the datagrams it sends.
+ *
+ * Impairments are drawn from a generator seeded with options.seed, so the same
+ * sequence of sends is lost, duplicated and reordered the same way on every run.
+ *
+ *   loss            probability a datagram is dropped
+ *   duplicate       probability a datagram is delivered twice
+ *   reorder         probability a datagram is held back by reorderDelay ms
+ *   delay, jitter   one way delay in ms, plus uniform [0, jitter) ms
+ *   rate            link rate in bytes per second, 0 is unlimited
+ *   queueBytes      bytes waiting for the link beyond which datagrams are dropped
+ *
+ * Received datagrams are passed through; decorate both ends to impair both directions.
+ *
+ * With options.clock, a CVirtualClock, datagrams are delivered when the clock is
+ * advanced. Otherwise they are delivered in real time by timers.
+ */
+class CNetworkEmulator extends CTransport {
+    constructor(transport, options = {}) {
+        super();
+        this.transport = transport;
+        this.clock = options.clock || null;
+        this.closed = false;
+        this.chunkPacing = transport.chunkPacing;
+        this.random = createRandom(options.seed || 0);
+        this.loss = 0;
+        this.duplicate = 0;
+        this.reorder = 0;
+        this.reorderDelay = 10;
+        this.delay = 0;
+        this.jitter = 0;
+        this.rate = 0;
+        this.queueBytes = 1024 * 1024;
+        this.linkFreeAt = 0;
+        this.timers = new Set();
+        this.stats = { sent: 0, delivered: 0, lost: 0, queueDropped: 0, duplicated: 0, reordered: 0 };
+        this.configure(Object.fromEntries(Object.entries(options).filter(([name]) => name !== 'seed' && name !== 'clock')));
+    }
+
+    /**
+     * Change impairments at runtime e.g. configure({ loss: 1 }) to cut the link.
+     */
+    configure(impairments) {
+        for (const [name, value] of Object.entries(impairments)) {
+            if (!NETWORK_IMPAIRMENTS.includes(name)) {
+                throw new Error(`Unknown impairment ${name}`);
+            }
+            this[name] = value;
+        }
+    }
+
+    getStats() {
+        return { ...this.stats };
+    }
+
+    detectChunkSize(targetIP) {
+        return this.transport.detectChunkSize(targetIP);
+    }
+
+    open(onDatagram) {
+        this.transport.moduleAddress = this.moduleAddress;
+        this.transport.communicatorModuleAddress = this.communicatorModuleAddress;
+        this.transport.open(onDatagram);
+        this.closed = false;
+    }
+
+    close() {
+        this.closed = true;
+        for (const timer of this.timers) {
+            clearTimeout(timer);
+        }
+        this.timers.clear();
+        this.transport.close();
+    }
+
+    sendDatagram(datagram) {
+        // fixed number of draws per datagram keeps runs aligned whatever the settings.
+        const lost = this.random() < this.loss;
+        const duplicated = this.random() < this.duplicate;
+        const reordered = this.random() < this.reorder;
+        const jitter = this.random() * this.jitter;
+
+        this.stats.sent += 1;
+        if (lost) {
+            this.stats.lost += 1;
+            return;
+        }
+
+        const now = this.clock ? this.clock.now() : Date.now();
+        let departure = now;
+        if (this.rate > 0) {
+            const start = Math.max(now, this.linkFreeAt);
+            if ((start - now) * this.rate / 1000 + datagram.length > this.queueBytes) {
+                this.stats.queueDropped += 1;
+                return;
+            }
+            departure = start + datagram.length * 1000 / this.rate;
+            this.linkFreeAt = departure;
+        }
+
+        let arrival = departure + this.delay + jitter;
+        if (reordered) {
+            arrival += this.reorderDelay;
+            this.stats.reordered += 1;
+        }
+
+        const copy = Buffer.from(datagram);
+        this.schedule(arrival - now, copy);
+        if (duplicated) {
+            this.stats.duplicated += 1;
+            this.schedule(arrival - now, copy);
+        }
+    }
+
+    schedule(wait, datagram) {
+        if (this.clock) {
+            this.clock.schedule(this.clock.now() + Math.max(0, wait), () => {
+                if (!this.closed) {
+                    this.stats.delivered += 1;
+                    this.transport.sendDatagram(datagram);
+                }
+            });
+            return;
+        }
+        const timer = setTimeout(() => {
+            this.timers.delete(timer);
+            this.stats.delivered += 1;
+            this.transport.sendDatagram(datagram);
+        }, Math.max(0, wait));
+        this.timers.add(timer);
+    }
+}
+
+module.exports = CNetworkEmulator;
+module.exports.NETWORK_IMPAIRMENTS = NETWORK_IMPAIRMENTS;
+module.exports.CNetworkEmulator = CNetworkEmulator;
+module.exports.CVirtualClock = CVirtualClock;
@@ -0,0 +1,281 @@
+/**
+ * DroneEngage DataBus - throughput and recovery over an emulated link
+ *
+ * Two modules run in this process, connected through a stand-in for de_comm over a CMemoryNetwork:
+ *
+ *     sender module --> de_comm stand-in --[CNetworkEmulator]--> receiver module
+ *
+ * The stand-in relays every message from the sender over an impaired link to the receiver.
+ * The link runs on a CVirtualClock, and only relayed messages cross it (ID messages and
+ * their replies do not). So the same arguments and seed always give the same report.
+ *
+ * Usage: node network_emulation.js [--seed 1] [--loss 0.01] [--delay 20] [--jitter 0.5] [--outage 300] ...
+ */
+
+const crypto = require('crypto');
+const CModule = require('./de_module');
+const { CMemoryNetwork, CMemoryTransport } = require('./memoryTransport');
+const { CNetworkEmulator, CVirtualClock } = require('./networkEmulator');
+const { ANDRUAV_PROTOCOL_MESSAGE_TYPE, ANDRUAV_PROTOCOL_MESSAGE_CMD, ANDRUAV_PROTOCOL_SENDER, ANDRUAV_PROTOCOL_GROUP_ID, INTERMODULE_ROUTING_TYPE, CMD_TYPE_INTERMODULE, JSON_INTERMODULE_PARTY_RECORD, JSON_INTERMODULE_RESEND, TYPE_AndruavModule_ID, TYPE_AndruavMessage_DUMMY } = require('./messages');
+
+const COMM_PORT = 60000;
+const RELAY_PORT = 60001;
+const SENDER_PORT = 61001;
+const RECEIVER_PORT = 61002;
+// the receiver's ID messages go nowhere, so nothing but relayed messages reaches it.
+const UNUSED_PORT = 60999;
+
+const RECEIVER_PARTY_ID = 'receiver';
+// ms of virtual time per clock step, the resolution of the report.
+const CLOCK_STEP = 1;
+const ENVELOPE_SIZE = 130;
+
+const DEFAULT_OPTIONS = {
+    seed: 1,            // seed of the link impairments
+    loss: 0.01,         // datagram loss probability
+    duplicate: 0,       // datagram duplication probability
+    reorder: 0,         // datagram reorder probability
+    delay: 20,          // one way delay in ms
+    jitter: 0.5,        // uniform jitter in ms
+    rate: 1000000,      // link rate in bytes per second, 0 is unlimited
+    chunk: 1024,        // chunk size on the link in bytes
+    size: 4096,         // message size in bytes
+    count: 500,         // messages to send
+    interval: 5,        // ms between messages
+    outageAt: 1000,     // ms the link is cut at
+    outage: 300         // ms the link stays cut, 0 for none
+};
+
+function parseArguments() {
+    const args = process.argv.slice(2);
+    const options = { ...DEFAULT_OPTIONS };
+
+    for (let i = 0; i < args.length; i++) {
+        const arg = args[i];
+        if (arg === '-h' || arg === '--help') {
+            options.help = true;
+            continue;
+        }
+        // --outage-at sets outageAt
+        const name = arg.replace(/^--/, '').replace(/-([a-z])/g, (_, letter) => letter.toUpperCase());
+        if (!arg.startsWith('--') || !(name in DEFAULT_OPTIONS) || i + 1 >= args.length) {
+            throw new Error(`Unknown argument ${arg}`);
+        }
+        options[name] = parseFloat(args[++i]);
+    }
+    return options;
+}
+
+function printUsage() {
+    console.log('Throughput and recovery of the DataBus chunking protocol over an emulated link');
+    console.log();
+    console.log('USAGE: node network_emulation.js [OPTIONS]');
+    console.log();
+    for (const [name, value] of Object.entries(DEFAULT_OPTIONS)) {
+        console.log(`  --${name.replace(/[A-Z]/g, (letter) => '-' + letter.toLowerCase()).padEnd(12)} default: ${value}`);
+    }
+}
+
+/**
+ * Answers the sender's ID messages that ask for a reply, as de_comm does, and relays everything
+ * else to the receiver over the link.
+ */
+class CCommStandIn {
+    constructor(network, link) {
+        this.link = link;
+        this.transport = new CMemoryTransport(network);
+        this.transport.init('127.0.0.1', SENDER_PORT, '0.0.0.0', COMM_PORT, 0, (message, length) => this.onReceive(message, length));
+        this.transport.start();
+    }
+
+    onReceive(message, length) {
+        const end = message.indexOf(0);
+        const header = JSON.parse(message.toString('utf8', 0, end === -1 ? message.length : end));
+        if (header[ANDRUAV_PROTOCOL_MESSAGE_TYPE] !== TYPE_AndruavModule_ID) {
+            this.link.sendMSG(message, length);
+            return;
+        }
+        if (!(header[ANDRUAV_PROTOCOL_MESSAGE_CMD] || {})[JSON_INTERMODULE_RESEND]) {
+            return;
+        }
+        const reply = JSON.stringify({
+            [INTERMODULE_ROUTING_TYPE]: CMD_TYPE_INTERMODULE,
+            [ANDRUAV_PROTOCOL_MESSAGE_TYPE]: TYPE_AndruavModule_ID,
+            [ANDRUAV_PROTOCOL_MESSAGE_CMD]: {
+                [JSON_INTERMODULE_PARTY_RECORD]: { [ANDRUAV_PROTOCOL_SENDER]: 'comm', [ANDRUAV_PROTOCOL_GROUP_ID]: '1' }
+            }
+        });
+        this.transport.sendMSG(Buffer.from(reply), reply.length);
+    }
+
+    stop() {
+        this.transport.stop();
+    }
+}
+
+async function run(options) {
+    const clock = new CVirtualClock();
+    const network = new CMemoryNetwork();
+
+    const link = new CNetworkEmulator(new CMemoryTransport(network), {
+        seed: options.seed, loss: options.loss, duplicate: options.duplicate, reorder: options.reorder,
+        delay: options.delay, jitter: options.jitter, rate: options.rate, clock: clock
+    });
+    link.init('127.0.0.1', RECEIVER_PORT, '0.0.0.0', RELAY_PORT, options.chunk, null);
+    const comm = new CCommStandIn(network, link);
+
+    // the envelope takes about ENVELOPE_SIZE bytes of each message.
+    const padding = 'x'.repeat(Math.max(0, options.size - ENVELOPE_SIZE));
+    // message sequence -> virtual send time; { sequence, arrival, length, intact } in arrival order.
+    const sentAt = new Map();
+    const arrivals = [];
+
+    const receiver = CModule.createInstance();
+    receiver.defineModule('gen', 'receiver', 'receiver_key', '1.0', []);   // MODULE_CLASS_GENERIC
+    receiver.m_OnReceive = (message, length, jMsg) => {
+        const cmd = jMsg[ANDRUAV_PROTOCOL_MESSAGE_CMD] || {};
+        if ('s' in cmd) {
+            // the chunk protocol cannot tell a missing or reordered middle chunk, the padding can.
+            arrivals.push({ sequence: cmd.s, arrival: clock.now(), length, intact: cmd.p === padding });
+        }
+    };
+    receiver.init('127.0.0.1', UNUSED_PORT, '0.0.0.0', RECEIVER_PORT, 0, new CMemoryTransport(network));
+
+    const sender = CModule.createInstance();
+    sender.defineModule('gen', 'sender', 'sender_key', '1.0', []);   // MODULE_CLASS_GENERIC
+    sender.init('127.0.0.1', COMM_PORT, '0.0.0.0', SENDER_PORT, 0, new CMemoryTransport(network));
+
+    let stats;
+    try {
+        // the ID handshake runs in real time.
+        const deadline = Date.now() + 5000;
+        while (!sender.isLinkConnected() && Date.now() < deadline) {
+            await new Promise(resolve => setTimeout(resolve, 50));
+        }
+        if (!sender.isLinkConnected()) {
+            throw new Error('sender did not connect to the de_comm stand-in');
+        }
+
+        const outageEnd = options.outageAt + options.outage;
+        let cut = false;
+        let restored = options.outage <= 0;
+        let sequence = 0;
+
+        while (true) {
+            const now = clock.now();
+            if (!cut && options.outage > 0 && now >= options.outageAt) {
+                link.configure({ loss: 1 });
+                cut = true;
+            }
+            if (cut && !restored && now >= outageEnd) {
+                link.configure({ loss: options.loss });
+                restored = true;
+            }
+
+            while (sequence < options.count && sequence * options.interval <= now) {
+                sentAt.set(sequence, now);
+                sender.sendJMSG(RECEIVER_PARTY_ID, { s: sequence, p: padding }, TYPE_AndruavMessage_DUMMY, false);
+                sequence += 1;
+            }
+
+            // the relay draws its impairments at virtual time now.
+            await network.waitIdle();
+            if (sequence >= options.count && clock.nextEventTime() === null) {
+                break;
+            }
+            clock.advance(CLOCK_STEP);
+            await network.waitIdle();
+        }
+
+        stats = link.getStats();
+    } finally {
+        sender.uninit();
+        receiver.uninit();
+        comm.stop();
+        link.stop();
+    }
+
+    return { sentAt, arrivals, stats };
+}
+
+function report(options, { sentAt, arrivals, stats }) {
+    const delivered = new Map();
+    const corrupted = new Set();
+    for (const { sequence, arrival, length, intact } of arrivals) {
+        if (!intact) {
+            corrupted.add(sequence);
+        } else if (!delivered.has(sequence)) {
+            delivered.set(sequence, { arrival, length });
+        }
+    }
+    for (const sequence of delivered.keys()) {
+        corrupted.delete(sequence);
+    }
+
+    const outageEnd = options.outageAt + options.outage;
+    const inOutage = (sequence) => options.outage > 0 && sentAt.get(sequence) >= options.outageAt && sentAt.get(sequence) < outageEnd;
+    const lost = [...sentAt.keys()].filter(sequence => !delivered.has(sequence));
+    const lostInOutage = lost.filter(inOutage).length;
+
+    const firstSent = Math.min(...sentAt.values());
+    const lastArrival = Math.max(firstSent, ...[...delivered.values()].map(entry => entry.arrival));
+    const duration = Math.max(lastArrival - firstSent, CLOCK_STEP);
+    const deliveredBytes = [...delivered.values()].reduce((sum, entry) => sum + entry.length, 0);
+    const messageBytes = delivered.size > 0 ? deliveredBytes / delivered.size : options.size;
+    const latencies = [...delivered.entries()].map(([sequence, entry]) => entry.arrival - sentAt.get(sequence));
+    const percent = (value) => `${(value * 100).toFixed(1)}%`;
+
+    console.log(`link        loss ${percent(options.loss)}, delay ${options.delay} ms, jitter ${options.jitter.toFixed(1)} ms, ` +
+                `rate ${options.rate} B/s, chunk ${options.chunk} B, seed ${options.seed}`);
+    console.log(`sent        ${sentAt.size} messages of ${messageBytes.toFixed(0)} B, one every ${options.interval.toFixed(1)} ms`);
+    console.log(`delivered   ${delivered.size} (${percent(delivered.size / sentAt.size)}), lost ${lost.length}: ` +
+                `${lostInOutage} sent during the outage, ${lost.length - lostInOutage} to impairments ` +
+                `(${corrupted.size} of them delivered corrupted)`);
+    console.log(`throughput  ${(deliveredBytes / duration).toFixed(1)} kB/s of ${(messageBytes / options.interval).toFixed(1)} kB/s offered, ` +
+                `over ${(duration / 1000).toFixed(3)} s`);
+    if (latencies.length > 0) {
+        console.log(`latency     mean ${(latencies.reduce((a, b) => a + b, 0) / latencies.length).toFixed(1)} ms, max ${Math.max(...latencies).toFixed(1)} ms`);
+    }
+
+    if (options.outage > 0) {
+        const after = [...delivered.entries()].filter(([sequence]) => sentAt.get(sequence) >= outageEnd).map(([, entry]) => entry.arrival);
+        const broken = lost.filter(sequence => sentAt.get(sequence) >= outageEnd).length;
+        const window = `link cut ${(options.outageAt / 1000).toFixed(3)} s to ${(outageEnd / 1000).toFixed(3)} s`;
+        if (after.length > 0) {
+            console.log(`recovery    ${window}, first message sent after it delivered ${(Math.min(...after) - outageEnd).toFixed(1)} ms later, ${broken} lost after it`);
+        } else {
+            console.log(`recovery    ${window}, no message delivered after it`);
+        }
+    }
+
+    console.log(`emulator    ${JSON.stringify(stats)}`);
+    const order = crypto.createHash('sha1').update(JSON.stringify(arrivals.map(entry => [entry.sequence, entry.arrival, entry.length])));
+    console.log(`digest      ${order.digest('hex').slice(0, 16)}  (same arguments and seed, same digest)`);
+}
+
+async function main() {
+    const options = parseArguments();
+    if (options.help) {
+        printUsage();
+        return;
+    }
+
+    // the modules log every chunk and message.
+    const log = console.log;
+    const error = console.error;
+    console.log = () => {};
+    console.error = () => {};
+    let result;
+    try {
+        result = await run(options);
+    } finally {
+        console.log = log;
+        console.error = error;
+    }
+    report(options, result);
+}
+
+main().catch((e) => {
+    console.error(`ERROR: ${e.message}`);
+    process.exit(1);
+});
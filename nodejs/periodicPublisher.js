@@ -0,0 +1,191 @@
+const { performance } = require('perf_hooks');
+
+/**
+ * Calls producer callbacks at fixed rates from one timer.
+ * Deadlines are absolute and aligned to a common epoch, so they do not drift and
+ * harmonic rates fire on the same wakeup. Publishers with the same rate share one
+ * rate group and one deadline. A group that wakes up late by whole periods skips
+ * them instead of bursting to catch up; skipped periods are counted as overruns.
+ * No timer runs while no publisher is registered.
+ */
+class CPeriodicPublisher {
+    constructor() {
+        this.publishers = new Map();
+        // periodMs -> { nextDeadline, publishers }
+        this.groups = new Map();
+        this.nextId = 0;
+        this.epoch = null;
+        this.started = false;
+        this.timer = null;
+    }
+
+    start() {
+        // periods passed while stopped are not overruns.
+        const now = performance.now();
+        for (const [periodMs, group] of this.groups) {
+            if (group.nextDeadline <= now) {
+                group.nextDeadline = this.epoch + (Math.floor((now - this.epoch) / periodMs) + 1) * periodMs;
+            }
+        }
+        this.started = true;
+        this.arm();
+    }
+
+    stop() {
+        this.started = false;
+        if (this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        }
+    }
+
+    /**
+     * Call callback() rate times per second. Returns a publisher id.
+     */
+    addPublisher(rate, callback) {
+        if (!(rate > 0)) {
+            throw new Error('rate must be positive');
+        }
+        const publisher = {
+            id: this.nextId++,
+            periodMs: 1000 / rate,
+            callback: callback,
+            stats: { rate: rate, runs: 0, overruns: 0, jitterLast: 0, jitterMax: 0, jitterMean: 0 }
+        };
+        this.publishers.set(publisher.id, publisher);
+        this.joinGroup(publisher);
+        this.arm();
+        return publisher.id;
+    }
+
+    /**
+     * A callback may remove its own publisher. Returns false for unknown ids.
+     */
+    removePublisher(publisherId) {
+        const publisher = this.publishers.get(publisherId);
+        if (!publisher) {
+            return false;
+        }
+        this.publishers.delete(publisherId);
+        this.leaveGroup(publisher);
+        this.arm();
+        return true;
+    }
+
+    /**
+     * Move the publisher to the rate group of rate, from the next deadline of that group.
+     */
+    setRate(publisherId, rate) {
+        if (!(rate > 0)) {
+            throw new Error('rate must be positive');
+        }
+        const publisher = this.publishers.get(publisherId);
+        if (!publisher) {
+            return false;
+        }
+        publisher.stats.rate = rate;
+        if (publisher.periodMs === 1000 / rate) {
+            return true;
+        }
+        this.leaveGroup(publisher);
+        publisher.periodMs = 1000 / rate;
+        this.joinGroup(publisher);
+        this.arm();
+        return true;
+    }
+
+    /**
+     * rate, runs, overruns and jitterLast/Max/Mean in ms (call time - deadline).
+     */
+    getStats(publisherId) {
+        const publisher = this.publishers.get(publisherId);
+        return publisher ? { ...publisher.stats } : null;
+    }
+
+    joinGroup(publisher) {
+        // a new group gets the first deadline after now on the grid of its period from epoch.
+        let group = this.groups.get(publisher.periodMs);
+        if (!group) {
+            const now = performance.now();
+            if (this.epoch === null) {
+                this.epoch = now;
+            }
+            const nextDeadline = this.epoch + (Math.floor((now - this.epoch) / publisher.periodMs) + 1) * publisher.periodMs;
+            group = { nextDeadline: nextDeadline, publishers: [] };
+            this.groups.set(publisher.periodMs, group);
+        }
+        group.publishers.push(publisher);
+    }
+
+    leaveGroup(publisher) {
+        const group = this.groups.get(publisher.periodMs);
+        if (!group) {
+            return;
+        }
+        group.publishers = group.publishers.filter((member) => member !== publisher);
+        if (group.publishers.length === 0) {
+            this.groups.delete(publisher.periodMs);
+        }
+    }
+
+    /**
+     * Set the one timer for the earliest group, none when there is no group.
+     */
+    arm() {
+        if (this.timer) {
+            clearTimeout(this.timer);
+            this.timer = null;
+        }
+        if (!this.started || this.groups.size === 0) {
+            return;
+        }
+        let nextDeadline = Infinity;
+        for (const group of this.groups.values()) {
+            nextDeadline = Math.min(nextDeadline, group.nextDeadline);
+        }
+        // setTimeout truncates fractional delays, round up so it does not fire early.
+        this.timer = setTimeout(() => this.run(), Math.max(0, Math.ceil(nextDeadline - performance.now())));
+    }
+
+    run() {
+        this.timer = null;
+
+        // every group due by now runs on this one wakeup.
+        const now = performance.now();
+        const due = [];
+        for (const [periodMs, group] of this.groups) {
+            const deadline = group.nextDeadline;
+            if (deadline > now) {
+                continue;
+            }
+            const missed = Math.floor((now - deadline) / periodMs);
+            group.nextDeadline = deadline + (missed + 1) * periodMs;
+            for (const publisher of group.publishers) {
+                due.push({ publisher, deadline, missed });
+            }
+        }
+
+        for (const { publisher, deadline, missed } of due) {
+            // removed by an earlier callback of this wakeup.
+            if (this.publishers.get(publisher.id) !== publisher) {
+                continue;
+            }
+            const jitter = performance.now() - deadline;
+            try {
+                publisher.callback();
+            } catch (e) {
+                console.error(`Error in publisher callback: ${e}`);
+            }
+            const stats = publisher.stats;
+            stats.runs += 1;
+            stats.overruns += missed;
+            stats.jitterLast = jitter;
+            stats.jitterMax = Math.max(stats.jitterMax, jitter);
+            stats.jitterMean += (jitter - stats.jitterMean) / stats.runs;
+        }
+
+        this.arm();
+    }
+}
+
+module.exports = CPeriodicPublisher;
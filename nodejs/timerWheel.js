@@ -0,0 +1,71 @@
+/**
+ * Hashed timer wheel used to expire pending requests.
+ * Timers are rounded up to the tick resolution. The tick interval only runs
+ * while at least one timer is scheduled, so an idle module costs no wakeups.
+ */
+class CTimerWheel {
+    constructor(tickMs = 50, slots = 64) {
+        this.tickMs = tickMs;
+        this.slots = Array.from({ length: slots }, () => []);
+        this.cursor = 0;
+        this.count = 0;
+        this.interval = null;
+    }
+
+    schedule(delayMs, callback) {
+        const ticks = Math.max(1, Math.ceil(delayMs / this.tickMs));
+        const slot = (this.cursor + ticks) % this.slots.length;
+        const entry = {
+            rounds: Math.floor((ticks - 1) / this.slots.length),
+            callback: callback,
+            cancelled: false,
+            cancel() { this.cancelled = true; }
+        };
+        this.slots[slot].push(entry);
+        this.count += 1;
+
+        if (!this.interval) {
+            this.interval = setInterval(() => this.tick(), this.tickMs);
+        }
+        return entry;
+    }
+
+    tick() {
+        this.cursor = (this.cursor + 1) % this.slots.length;
+        const expired = [];
+        const remaining = [];
+        for (const entry of this.slots[this.cursor]) {
+            if (entry.cancelled) {
+                this.count -= 1;
+            } else if (entry.rounds > 0) {
+                entry.rounds -= 1;
+                remaining.push(entry);
+            } else {
+                this.count -= 1;
+                expired.push(entry);
+            }
+        }
+        this.slots[this.cursor] = remaining;
+
+        if (this.count === 0) {
+            this.stop();
+        }
+
+        for (const entry of expired) {
+            try {
+                entry.callback();
+            } catch (e) {
+                console.error(`Error in timer callback: ${e}`);
+            }
+        }
+    }
+
+    stop() {
+        if (this.interval) {
+            clearInterval(this.interval);
+            this.interval = null;
+        }
+    }
+}
+
+module.exports = CTimerWheel;
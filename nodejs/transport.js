@@ -0,0 +1,406 @@
+const { EventEmitter } = require('events');
+
+const DEFAULT_UDP_DATABUS_PACKET_SIZE = 8192;
+// pass as chunkSize to choose the chunk size from the path to de_comm.
+const UDP_DATABUS_PACKET_SIZE_AUTO = 0;
+
+const UDP_MAX_DATAGRAM_SIZE = 65507;
+const UDP_CHUNK_HEADER_SIZE = 2;
+
+// milliseconds after every DEFAULT_UDP_DATABUS_PACKET_SIZE bytes of one message, scaled to the chunk length so
+// the send rate does not depend on the chunk size. Fast sending causes packet loss.
+const DEFAULT_CHUNK_PACING = 10;
+
+const UDP_LAST_CHUNK_NUMBER = 0xFFFF;
+// a forwarded message whose last chunk has not arrived within this many ms is abandoned.
+const FORWARD_STALL_TIMEOUT = 1000;
+
+/**
+ * Base transport used by CModule.
+ * Implements the databus chunking protocol, reassembly and the periodic ID sender.
+ * Subclasses only move datagrams: open(), close(), sendDatagram() and detectChunkSize().
+ */
+class CTransport extends EventEmitter {
+    constructor() {
+        super();
+        this.moduleAddress = null;
+        this.communicatorModuleAddress = null;
+        this.chunkSize = 0;
+        this.chunkSizePinned = false;
+        this.chunkPacing = DEFAULT_CHUNK_PACING;
+        this.stoppedCalled = false;
+        this.started = false;
+        this.jsonID = '';
+        this.receivedChunks = [];
+        this.idInterval = 1000;
+        this.idWake = null;
+        this.idTickCallback = null;
+        this.chunkHandler = null;
+        // messages and forwarded messages are sent one after the other, never interleaved.
+        this.sendLock = Promise.resolve();
+        this.forwardSession = null;
+    }
+
+    init(targetIP, broadcastPort, host, listeningPort, chunkSize, onReceiveCallback) {
+        this.chunkSizePinned = chunkSize > UDP_DATABUS_PACKET_SIZE_AUTO;
+        this.localChunkSize = this.chunkSizePinned ? chunkSize : this.detectChunkSize(targetIP);
+        // until the peer advertises its chunk size, send what a legacy receiver accepts.
+        this.chunkSize = this.chunkSizePinned ? this.localChunkSize : Math.min(this.localChunkSize, DEFAULT_UDP_DATABUS_PACKET_SIZE);
+        if (onReceiveCallback) {
+            this.on('data', (data) => onReceiveCallback(data, data.length));
+        }
+        this.moduleAddress = { address: host, port: listeningPort };
+        this.communicatorModuleAddress = { address: targetIP, port: broadcastPort };
+
+        this.open((datagram) => this.internalReceiverEntry(datagram));
+    }
+
+    /**
+     * Start listening on moduleAddress and call onDatagram(Buffer) for every received chunk.
+     */
+    open(onDatagram) {
+        throw new Error("open() not implemented");
+    }
+
+    close() {
+        throw new Error("close() not implemented");
+    }
+
+    /**
+     * Send one chunk to communicatorModuleAddress.
+     */
+    sendDatagram(datagram) {
+        throw new Error("sendDatagram() not implemented");
+    }
+
+    detectChunkSize(targetIP) {
+        return DEFAULT_UDP_DATABUS_PACKET_SIZE;
+    }
+
+    /**
+     * Set the chunk size. A pinned size is never replaced by negotiation.
+     */
+    setChunkSize(chunkSize, pinned = true) {
+        if (chunkSize <= UDP_DATABUS_PACKET_SIZE_AUTO) {
+            return;
+        }
+        this.chunkSize = Math.min(chunkSize, UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE);
+        this.localChunkSize = this.chunkSize;
+        this.chunkSizePinned = pinned;
+    }
+
+    /**
+     * Agree on the smaller of our chunk size and the one advertised by the peer.
+     * Called when the peer's ID reply carries its chunk size. Peers that never
+     * advertise one keep receiving DEFAULT_UDP_DATABUS_PACKET_SIZE chunks.
+     */
+    negotiateChunkSize(peerChunkSize) {
+        if (this.chunkSizePinned || !(peerChunkSize > 0)) {
+            return;
+        }
+        this.chunkSize = Math.min(this.localChunkSize, peerChunkSize);
+    }
+
+    /**
+     * Milliseconds to wait after every DEFAULT_UDP_DATABUS_PACKET_SIZE bytes of one message.
+     */
+    setChunkPacing(pacing) {
+        this.chunkPacing = pacing;
+    }
+
+    /**
+     * Milliseconds to wait after a chunk of chunkLength bytes.
+     */
+    chunkPause(chunkLength) {
+        return this.chunkPacing * chunkLength / DEFAULT_UDP_DATABUS_PACKET_SIZE;
+    }
+
+    start() {
+        if (this.started) {
+            throw new Error("Start called twice");
+        }
+        this.started = true;
+        this.startSenderID();
+    }
+
+    stop() {
+        this.stoppedCalled = true;
+        if (this.idWake) {
+            this.idWake();
+        }
+        this.endForwardSession();
+        this.close();
+    }
+
+    /**
+     * handler(datagram, chunkNumber, first) sees every received chunk before reassembly.
+     * first is true when no chunk of the current message has been kept yet.
+     * Returning true consumes the chunk, it is not reassembled.
+     */
+    setChunkHandler(handler) {
+        this.chunkHandler = handler;
+    }
+
+    internalReceiverEntry(received) {
+        const chunkNumber = (received[1] << 8) | received[0];
+
+        if (chunkNumber === 0) {
+            this.receivedChunks = [];
+        }
+        if (this.chunkHandler && this.chunkHandler(received, chunkNumber, this.receivedChunks.length === 0)) {
+            return;
+        }
+        this.receivedChunks.push(received.slice(2));
+
+        if (chunkNumber === 0xFFFF) {
+            const concatenatedData = Buffer.concat(this.receivedChunks);
+            this.emit('data', concatenatedData);
+            this.receivedChunks = [];
+        }
+    }
+
+    setJsonId(jsonID) {
+        this.jsonID = jsonID;
+    }
+
+    /**
+     * Milliseconds between ID messages. wake sends the next ID immediately.
+     */
+    setIdInterval(interval, wake = false) {
+        this.idInterval = interval;
+        if (wake && this.idWake) {
+            this.idWake();
+        }
+    }
+
+    /**
+     * callback() is called before each ID message.
+     */
+    setIdTickCallback(callback) {
+        this.idTickCallback = callback;
+    }
+
+    async startSenderID() {
+        while (!this.stoppedCalled) {
+            if (this.idTickCallback) {
+                this.idTickCallback();
+            }
+            if (this.jsonID) {
+                await this.sendMSG(Buffer.from(this.jsonID), this.jsonID.length);
+            }
+            await new Promise(resolve => {
+                const timer = setTimeout(resolve, this.idInterval);
+                this.idWake = () => { clearTimeout(timer); resolve(); };
+            });
+            this.idWake = null;
+        }
+    }
+
+    /**
+     * Cut-through relay of a received chunk. Chunks of one forwarded message are kept
+     * together on the wire, sendMSG() calls wait until its last chunk. The datagram is
+     * sent as is when it fits the chunk size, otherwise it is split and renumbered.
+     */
+    forwardDatagram(datagram, first) {
+        if (this.stoppedCalled) {
+            return;
+        }
+        if (first) {
+            this.endForwardSession();
+            this.startForwardSession();
+        } else if (!this.forwardSession) {
+            // the rest of a message abandoned after FORWARD_STALL_TIMEOUT.
+            return;
+        }
+        const session = this.forwardSession;
+        if (session.active) {
+            this.sendForwarded(session, datagram);
+        } else {
+            session.pending.push(datagram);
+        }
+    }
+
+    /**
+     * True while a forwarded message is in flight and its last chunk has not been sent.
+     */
+    isForwarding() {
+        return this.forwardSession !== null;
+    }
+
+    startForwardSession() {
+        const session = { active: false, pending: [], nextChunk: 0, release: null, timer: null };
+        this.forwardSession = session;
+        this.sendLock = this.sendLock.then(() => new Promise(resolve => {
+            session.release = resolve;
+            session.active = true;
+            this.armForwardStall(session);
+            const pending = session.pending;
+            session.pending = [];
+            for (const datagram of pending) {
+                this.sendForwarded(session, datagram);
+            }
+            if (session.ended) {
+                this.releaseForwardSession(session);
+            }
+        }));
+    }
+
+    endForwardSession() {
+        const session = this.forwardSession;
+        if (!session) {
+            return;
+        }
+        this.forwardSession = null;
+        session.ended = true;
+        if (session.active) {
+            this.releaseForwardSession(session);
+        }
+    }
+
+    releaseForwardSession(session) {
+        clearTimeout(session.timer);
+        if (this.forwardSession === session) {
+            this.forwardSession = null;
+        }
+        session.release();
+    }
+
+    armForwardStall(session) {
+        clearTimeout(session.timer);
+        // the last chunk never came.
+        session.timer = setTimeout(() => this.releaseForwardSession(session), FORWARD_STALL_TIMEOUT);
+    }
+
+    sendForwarded(session, datagram) {
+        const chunkNumber = (datagram[1] << 8) | datagram[0];
+        const last = chunkNumber === UDP_LAST_CHUNK_NUMBER;
+        const payloadLength = datagram.length - UDP_CHUNK_HEADER_SIZE;
+
+        if (payloadLength <= this.chunkSize && (last || chunkNumber === session.nextChunk)) {
+            this.sendDatagram(datagram);
+            session.nextChunk += 1;
+        } else {
+            // an empty last chunk is still sent, it ends the message.
+            let offset = 0;
+            do {
+                const piece = datagram.subarray(UDP_CHUNK_HEADER_SIZE + offset, UDP_CHUNK_HEADER_SIZE + Math.min(offset + this.chunkSize, payloadLength));
+                offset += piece.length;
+                const number = (last && offset >= payloadLength) ? UDP_LAST_CHUNK_NUMBER : session.nextChunk;
+                const chunkMsg = Buffer.alloc(piece.length + UDP_CHUNK_HEADER_SIZE);
+                chunkMsg[0] = number & 0xFF;
+                chunkMsg[1] = (number >> 8) & 0xFF;
+                piece.copy(chunkMsg, UDP_CHUNK_HEADER_SIZE);
+                this.sendDatagram(chunkMsg);
+                session.nextChunk += 1;
+            } while (offset < payloadLength);
+        }
+
+        if (last) {
+            session.ended = true;
+            this.releaseForwardSession(session);
+        } else {
+            this.armForwardStall(session);
+        }
+    }
+
+    sendMSG(msg, length) {
+        const send = this.sendLock.then(() => this.sendChunks(msg, length));
+        this.sendLock = send.catch(() => {});
+        return send;
+    }
+
+    /**
+     * Send the messages head + tail for every head in heads. tail is chunked once:
+     * only the first chunk, which carries the head, differs between messages,
+     * the datagrams of the rest of tail are shared.
+     */
+    sendFanOut(heads, tail) {
+        if (heads.length === 0) {
+            return Promise.resolve();
+        }
+        const firstRoom = this.chunkSize - Math.max(...heads.map(head => head.length));
+        if (firstRoom <= 0) {
+            // a head fills the first chunk, nothing to share.
+            return Promise.all(heads.map(head => {
+                const msg = Buffer.concat([head, tail]);
+                return this.sendMSG(msg, msg.length);
+            }));
+        }
+        const send = this.sendLock.then(() => this.sendFanOutChunks(heads, tail, firstRoom));
+        this.sendLock = send.catch(() => {});
+        return send;
+    }
+
+    async sendFanOutChunks(heads, tail, firstRoom) {
+        const firstPiece = tail.subarray(0, firstRoom);
+        const shared = [];
+        for (let offset = firstRoom; offset < tail.length; offset += this.chunkSize) {
+            const piece = tail.subarray(offset, offset + this.chunkSize);
+            const number = (offset + piece.length >= tail.length) ? UDP_LAST_CHUNK_NUMBER : shared.length + 1;
+            const chunkMsg = Buffer.alloc(piece.length + UDP_CHUNK_HEADER_SIZE);
+            chunkMsg[0] = number & 0xFF;
+            chunkMsg[1] = (number >> 8) & 0xFF;
+            piece.copy(chunkMsg, UDP_CHUNK_HEADER_SIZE);
+            shared.push(chunkMsg);
+        }
+        const firstHeader = Buffer.from(shared.length > 0 ? [0x00, 0x00] : [0xFF, 0xFF]);
+
+        for (const head of heads) {
+            if (this.stoppedCalled) {
+                return;
+            }
+            this.sendDatagram(Buffer.concat([firstHeader, head, firstPiece]));
+            for (const datagram of shared) {
+                if (this.chunkPacing > 0) {
+                    // every datagram before this one is a full chunk.
+                    await this.delay(this.chunkPause(this.chunkSize));
+                }
+                this.sendDatagram(datagram);
+            }
+        }
+    }
+
+    async sendChunks(msg, length) {
+        let remainingLength = length;
+        let offset = 0;
+        let chunkNumber = 0;
+
+        while (remainingLength > 0 && !this.stoppedCalled) {
+            const chunkLength = Math.min(this.chunkSize, remainingLength);
+            remainingLength -= chunkLength;
+
+            const totalLength = chunkLength + 2;
+            const chunkMsg = Buffer.alloc(totalLength);
+
+            if (remainingLength === 0) {
+                chunkMsg[0] = 0xFF;
+                chunkMsg[1] = 0xFF;
+            } else {
+                chunkMsg[0] = chunkNumber & 0xFF;
+                chunkMsg[1] = (chunkNumber >> 8) & 0xFF;
+            }
+
+            console.log(`chunkNumber: ${chunkNumber} :chunkLength: ${chunkLength}`);
+            msg.copy(chunkMsg, 2, offset, offset + chunkLength);
+            this.sendDatagram(chunkMsg);
+
+            if (remainingLength !== 0 && this.chunkPacing > 0) {
+                await this.delay(this.chunkPause(chunkLength));
+            }
+
+            offset += chunkLength;
+            chunkNumber += 1;
+        }
+    }
+
+    delay(ms) {
+        return new Promise(resolve => setTimeout(resolve, ms));
+    }
+}
+
+module.exports = CTransport;
+module.exports.DEFAULT_UDP_DATABUS_PACKET_SIZE = DEFAULT_UDP_DATABUS_PACKET_SIZE;
+module.exports.UDP_DATABUS_PACKET_SIZE_AUTO = UDP_DATABUS_PACKET_SIZE_AUTO;
+module.exports.UDP_MAX_DATAGRAM_SIZE = UDP_MAX_DATAGRAM_SIZE;
+module.exports.UDP_CHUNK_HEADER_SIZE = UDP_CHUNK_HEADER_SIZE;
+module.exports.UDP_LAST_CHUNK_NUMBER = UDP_LAST_CHUNK_NUMBER;
@@ -1,116 +1,69 @@
 const dgram = require('dgram');
-const { EventEmitter } = require('events');
+const net = require('net');
+const CTransport = require('./transport');
+const { DEFAULT_UDP_DATABUS_PACKET_SIZE, UDP_DATABUS_PACKET_SIZE_AUTO, UDP_MAX_DATAGRAM_SIZE, UDP_CHUNK_HEADER_SIZE } = require('./transport');
 
-class CUDPClient extends EventEmitter {
+const IP_UDP_HEADER_SIZE = 28;
+const DEFAULT_PATH_MTU = 1500;
+
+/**
+ * CTransport over a UDP socket to de_comm.
+ */
+class CUDPClient extends CTransport {
     constructor() {
         super();
         this.socket = null;
-        this.moduleAddress = null;
-        this.communicatorModuleAddress = null;
-        this.chunkSize = 0;
-        this.stoppedCalled = false;
-        this.started = false;
-        this.jsonID = '';
     }
 
-    init(targetIP, broadcastPort, host, listeningPort, chunkSize) {
-        this.chunkSize = chunkSize;
+    open(onDatagram) {
         this.socket = dgram.createSocket('udp4');
-        this.moduleAddress = { address: host, port: listeningPort };
-        this.communicatorModuleAddress = { address: targetIP, port: broadcastPort };
 
-        this.socket.bind(listeningPort, host, () => {
-            console.log(`UDP Listener at ${host}:${listeningPort}`);
-            console.log(`Expected Comm Server at ${targetIP}:${broadcastPort}`);
-            console.log(`UDP Max Packet Size ${chunkSize}`);
+        this.socket.bind(this.moduleAddress.port, this.moduleAddress.address, () => {
+            console.log(`UDP Listener at ${this.moduleAddress.address}:${this.moduleAddress.port}`);
+            console.log(`Expected Comm Server at ${this.communicatorModuleAddress.address}:${this.communicatorModuleAddress.port}`);
+            console.log(`UDP Max Packet Size ${this.chunkSize}${this.chunkSizePinned ? '' : ' (auto)'}`);
         });
 
-        this.socket.on('message', (msg, rinfo) => this.internalReceiverEntry(msg));
+        this.socket.on('message', (msg, rinfo) => onDatagram(msg));
     }
 
-    start() {
-        if (this.started) {
-            throw new Error("Start called twice");
-        }
-        this.started = true;
-        this.startSenderID();
-    }
-
-    stop() {
-        this.stoppedCalled = true;
+    close() {
         if (this.socket) {
             this.socket.close();
+            this.socket = null;
         }
     }
 
-    internalReceiverEntry(received) {
-        let receivedChunks = [];
-        const chunkNumber = (received[1] << 8) | received[0];
-
-        if (chunkNumber === 0) {
-            receivedChunks = [];
-        }
-        receivedChunks.push(received.slice(2));
-
-        if (chunkNumber === 0xFFFF) {
-            const concatenatedData = Buffer.concat(receivedChunks);
-            this.emit('data', concatenatedData);
-            receivedChunks = [];
-        }
+    sendDatagram(datagram) {
+        this.socket.send(datagram, 0, datagram.length, this.communicatorModuleAddress.port, this.communicatorModuleAddress.address);
     }
 
-    setJsonId(jsonID) {
-        this.jsonID = jsonID;
+    detectChunkSize(targetIP) {
+        return CUDPClient.detectChunkSize(targetIP);
     }
 
-    async startSenderID() {
-        while (!this.stoppedCalled) {
-            if (this.jsonID) {
-                await this.sendMSG(Buffer.from(this.jsonID), this.jsonID.length);
-            }
-            await this.delay(1000); // 1 second
+    /**
+     * Largest chunk that crosses the path to targetIP without IP fragmentation.
+     * Loopback has no fragmentation cost so the maximum datagram is used. Node.js
+     * cannot query the kernel path MTU, so other paths assume an Ethernet MTU.
+     * Host names are not resolved and get DEFAULT_UDP_DATABUS_PACKET_SIZE.
+     */
+    static detectChunkSize(targetIP) {
+        const isLoopback = (targetIP === 'localhost') || (targetIP === '0.0.0.0') || (targetIP === '::1')
+            || (net.isIPv4(targetIP) && targetIP.startsWith('127.'));
+        if (isLoopback) {
+            return UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE;
         }
-    }
-
-    async sendMSG(msg, length) {
-        let remainingLength = length;
-        let offset = 0;
-        let chunkNumber = 0;
-
-        while (remainingLength > 0) {
-            const chunkLength = Math.min(this.chunkSize, remainingLength);
-            remainingLength -= chunkLength;
-
-            const totalLength = chunkLength + 2;
-            const chunkMsg = Buffer.alloc(totalLength);
-
-            if (remainingLength === 0) {
-                chunkMsg[0] = 0xFF;
-                chunkMsg[1] = 0xFF;
-            } else {
-                chunkMsg[0] = chunkNumber & 0xFF;
-                chunkMsg[1] = (chunkNumber >> 8) & 0xFF;
-            }
-
-            console.log(`chunkNumber: ${chunkNumber} :chunkLength: ${chunkLength}`);
-            msg.copy(chunkMsg, 2, offset, offset + chunkLength);
-            this.socket.send(chunkMsg, 0, chunkMsg.length, this.communicatorModuleAddress.port, this.communicatorModuleAddress.address);
-
-            if (remainingLength !== 0) {
-                await this.delay(10); // 10 milliseconds
-            }
-
-            offset += chunkLength;
-            chunkNumber += 1;
+        if (!net.isIP(targetIP)) {
+            return DEFAULT_UDP_DATABUS_PACKET_SIZE;
         }
-    }
-
-    delay(ms) {
-        return new Promise(resolve => setTimeout(resolve, ms));
+        return DEFAULT_PATH_MTU - IP_UDP_HEADER_SIZE - UDP_CHUNK_HEADER_SIZE;
     }
 }
 
 module.exports = CUDPClient;
+module.exports.DEFAULT_UDP_DATABUS_PACKET_SIZE = DEFAULT_UDP_DATABUS_PACKET_SIZE;
+module.exports.UDP_DATABUS_PACKET_SIZE_AUTO = UDP_DATABUS_PACKET_SIZE_AUTO;
 
 // // Example usage:
 // const client = new CUDPClient();
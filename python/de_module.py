@@ -3,9 +3,13 @@
 import json
 import time
 import threading
+from collections import deque
+from concurrent.futures import Future
 from enum import Enum
 from messages import *
 from udpClient import *
+from timerWheel import *
+from periodicPublisher import *
 
 
 MODULE_FEATURE_RECEIVING_TELEMETRY      = "R"
@@ -23,6 +27,78 @@ MODULE_CLASS_GENERIC                    = "gen"
 HARDWARE_TYPE_UNDEFINED = 0
 HARDWARE_TYPE_CPU = 1
 
+DEFAULT_REQUEST_TIMEOUT = 5.0
+
+# Delivery policies, can be combined.
+DELIVERY_POLICY_NONE                    = 0
+DELIVERY_POLICY_CONFLATE                = 1     # keep only the newest pending message per type and sender
+DELIVERY_POLICY_TTL                     = 2     # drop messages older than ttl before dispatch
+
+DEFAULT_DISPATCH_QUEUE_SIZE             = 1024  # pending messages, the oldest is dropped when full
+
+
+# de_comm liveness
+DEFAULT_LIVENESS_DEADLINE               = 5.0   # seconds without traffic from de_comm before the link is down
+LINK_ID_RETRY_INTERVAL                  = 0.25  # ID resend interval while disconnected or probing
+LINK_HEARTBEAT_INTERVAL_MIN             = 1.0   # ID interval right after (re)connection
+LINK_HEARTBEAT_INTERVAL_MAX             = 8.0   # ID interval once the link is stable, capped to half the deadline
+
+# Outbound messages sent while de_comm is unreachable are kept in a bounded
+# buffer and flushed on reconnection. When it is full the oldest message of
+# the lowest priority not above the new one is dropped.
+OUTAGE_PRIORITY_DROP                    = 0     # never buffered
+OUTAGE_PRIORITY_LOW                     = 1
+OUTAGE_PRIORITY_NORMAL                  = 2
+OUTAGE_PRIORITY_HIGH                    = 3
+
+DEFAULT_OUTAGE_BUFFER_MESSAGES          = 256
+DEFAULT_OUTAGE_BUFFER_BYTES             = 4 * 1024 * 1024
+
+DEFAULT_OUTAGE_PRIORITIES = {
+    TYPE_AndruavMessage_LightTelemetry: OUTAGE_PRIORITY_DROP,
+    TYPE_AndruavMessage_MAVLINK: OUTAGE_PRIORITY_DROP,
+    TYPE_AndruavMessage_SWARM_MAVLINK: OUTAGE_PRIORITY_DROP,
+    TYPE_AndruavMessage_IMG: OUTAGE_PRIORITY_DROP,
+}
+
+
+class CPendingMessage(object):
+
+    def __init__(self, message, length, jMsg, conflate_key):
+        self.m_message = message
+        self.m_length = length
+        self.m_jMsg = jMsg
+        self.m_conflate_key = conflate_key
+        # local receive time: the sender's clock cannot be compared with ours.
+        self.m_received_at = time.monotonic()
+        self.m_dropped = False
+
+
+class CForwardingRule(object):
+
+    def __init__(self, message_types, target_party_id, transport, rewrite):
+        self.m_message_types = set(message_types) if message_types is not None else None
+        self.m_target_party_id = target_party_id
+        self.m_transport = transport
+        self.m_rewrite = rewrite
+
+    def matches(self, jHeader):
+        if self.m_message_types is not None and jHeader.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE) not in self.m_message_types:
+            return False
+        if self.m_target_party_id is not None and jHeader.get(ANDRUAV_PROTOCOL_TARGET_ID) != self.m_target_party_id:
+            return False
+        return True
+
+
+class CPendingRequest(object):
+
+    def __init__(self, correlation_id, target_party_id, reply_message_id, future):
+        self.m_correlation_id = correlation_id
+        self.m_target_party_id = target_party_id
+        self.m_reply_message_id = reply_message_id
+        self.m_future = future
+        self.m_timer = None
+
 class CModule(object):
 
     _instance = None
@@ -34,6 +110,14 @@ class CModule(object):
                 if cls._instance is None:
                     cls._instance = super(CModule, cls).__new__(cls)
         return cls._instance
+
+    @classmethod
+    def createInstance(cls):
+        """A module separate from the process wide CModule(), e.g. to connect several
+        modules over a CMemoryNetwork inside one process."""
+        instance = super(CModule, cls).__new__(cls)
+        instance.__init__()
+        return instance
     
     def __init__(self):
         self.m_module_class = ""
@@ -52,19 +136,98 @@ class CModule(object):
         self.m_hardware_serial_type = ""
         self.m_instance_time_stamp = time.time()
         self.m_lock = threading.RLock()
-
-    def init(self, target_ip, broadcasts_port, host, listening_port, chunk_size,):
-        # UDP Server
-        self.cUDPClient = CUDPClient()
+        self.m_pending_requests = {}
+        self.m_request_counter = 0
+        self.m_requests_lock = threading.Lock()
+        self.m_timer_wheel = CTimerWheel()
+        self.m_delivery_policies = {}
+        self.m_dispatch_queue = deque()
+        self.m_conflate_pending = {}
+        self.m_delivery_stats = {"conflate": {}, "ttl": {}, "overflow": {}}
+        self.m_dispatch_queue_size = DEFAULT_DISPATCH_QUEUE_SIZE
+        self.m_dispatch_cond = threading.Condition()
+        self.m_dispatch_thread = None
+        self.m_dispatch_stopped = False
+        self.m_link_connected = False
+        self.m_last_received = 0
+        self.m_liveness_deadline = DEFAULT_LIVENESS_DEADLINE
+        self.m_heartbeat_interval = LINK_HEARTBEAT_INTERVAL_MIN
+        self.m_link_probing = False
+        self.m_outage_priorities = dict(DEFAULT_OUTAGE_PRIORITIES)
+        # priority -> deque of (sequence, msg, length), oldest first
+        self.m_outage_buffer = {}
+        self.m_outage_buffer_count = 0
+        self.m_outage_buffer_bytes = 0
+        self.m_outage_sequence = 0
+        self.m_outage_flush_thread = None
+        # sends of the receiver thread made during a flush, run by the flush thread once it is done.
+        self.m_outage_after_flush = deque()
+        self.m_outage_max_messages = DEFAULT_OUTAGE_BUFFER_MESSAGES
+        self.m_outage_max_bytes = DEFAULT_OUTAGE_BUFFER_BYTES
+        self.m_outage_stats = {"flushed": 0, "dropped": {}}
+        self.m_outage_lock = threading.Lock()
+        self.m_outage_cond = threading.Condition(self.m_outage_lock)
+        self.m_forwarding_rules = {}
+        self.m_forwarding_rule_counter = 0
+        self.m_forward_rule = None
+        self.m_forward_stats = {"cut_through": 0, "stored": 0}
+        self.m_publisher = CPeriodicPublisher()
+
+    def init(self, target_ip, broadcasts_port, host, listening_port, chunk_size=UDP_DATABUS_PACKET_SIZE_AUTO,
+             transport=None):
+        """chunk_size: UDP_DATABUS_PACKET_SIZE_AUTO (0) chooses it from the path to de_comm, any other value pins it.
+        transport: CTransport to use instead of UDP e.g. CMemoryTransport or CNetworkEmulator.
+        """
+        # UDP Server by default
+        self.cUDPClient = transport if transport is not None else CUDPClient()
         self.cUDPClient.init(target_ip, broadcasts_port, host, listening_port, chunk_size, self.onReceive)
         self.createJSONID(True)
+        self.m_timer_wheel.start()
+        self.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL)
+        self.cUDPClient.setIdTickCallback(self._onLinkTick)
+        self.cUDPClient.setChunkHandler(self._onChunk)
         self.cUDPClient.start()
+        self.m_publisher.start()
+        with self.m_dispatch_cond:
+            if self.m_delivery_policies:
+                self._startDispatch()
         return True
 
     def uninit(self):
+        self.m_publisher.stop()
+        with self.m_outage_cond:
+            # also ends a running flush.
+            self.m_outage_buffer.clear()
+            self.m_outage_buffer_count = 0
+            self.m_outage_buffer_bytes = 0
+            self.m_outage_after_flush.clear()
         self.cUDPClient.stop()
+        self.m_timer_wheel.stop()
+        with self.m_dispatch_cond:
+            self.m_dispatch_stopped = True
+            self.m_dispatch_cond.notify()
+            dispatch_thread = self.m_dispatch_thread
+        if dispatch_thread and dispatch_thread.is_alive() and dispatch_thread is not threading.current_thread():
+            dispatch_thread.join(timeout=1.0)
+        with self.m_dispatch_cond:
+            # a later init() starts a new dispatch thread if policies are set.
+            self.m_dispatch_thread = None
+            self.m_dispatch_stopped = False
+            self.m_dispatch_queue.clear()
+            self.m_conflate_pending.clear()
+        with self.m_requests_lock:
+            pending = list(self.m_pending_requests.values())
+            self.m_pending_requests.clear()
+        for request in pending:
+            if not request.m_future.done():
+                request.m_future.cancel()
         return True
 
+    def setChunkSize(self, chunk_size):
+        """Pin the chunk size instead of negotiating it. Call after init()."""
+        self.cUDPClient.setChunkSize(chunk_size, pinned=True)
+        self.createJSONID(not self.m_FirstReceived or self.m_link_probing)
+
     def defineModule(self, module_class, module_id, module_key, module_version, message_filter):
         self.m_module_class = module_class
         self.m_module_id = module_id
@@ -72,6 +235,104 @@ class CModule(object):
         self.m_module_version = module_version
         self.m_message_filter = message_filter
 
+    def setDeliveryPolicy(self, andruav_message_id, policy, ttl=None):
+        """Set how received messages of a type are delivered to m_OnReceive.
+
+        Once a policy is set, received messages are queued and dispatched on a
+        separate thread so the receiver keeps draining the socket while the
+        consumer is busy.
+
+        Args:
+            andruav_message_id (int): message type
+            policy (int): DELIVERY_POLICY_CONFLATE and/or DELIVERY_POLICY_TTL
+            ttl (float, optional): max age in seconds, required with DELIVERY_POLICY_TTL.
+                Measured from when the message was received.
+        """
+        if (policy & DELIVERY_POLICY_TTL) and not ttl:
+            raise ValueError("DELIVERY_POLICY_TTL requires ttl")
+        with self.m_dispatch_cond:
+            if policy == DELIVERY_POLICY_NONE:
+                self.m_delivery_policies.pop(andruav_message_id, None)
+            else:
+                self.m_delivery_policies[andruav_message_id] = (policy, ttl)
+            self._startDispatch()
+
+    def setDispatchQueueSize(self, max_messages):
+        """Max messages waiting for dispatch, the oldest is dropped and counted as overflow when full."""
+        if max_messages <= 0:
+            raise ValueError("max_messages must be positive")
+        with self.m_dispatch_cond:
+            self.m_dispatch_queue_size = max_messages
+
+    def getDeliveryStats(self):
+        """Dropped message counters per reason and message type e.g. {"conflate": {2022: 10}, "ttl": {}, "overflow": {}}."""
+        with self.m_dispatch_cond:
+            return {policy: dict(counters) for policy, counters in self.m_delivery_stats.items()}
+
+    def _startDispatch(self):
+        # called with m_dispatch_cond held.
+        if self.m_dispatch_thread is None:
+            self.m_dispatch_thread = threading.Thread(target=self.InternalDispatchEntry, daemon=True)
+            self.m_dispatch_thread.start()
+
+    def _countDrop(self, policy_name, andruav_message_id):
+        counters = self.m_delivery_stats[policy_name]
+        counters[andruav_message_id] = counters.get(andruav_message_id, 0) + 1
+
+    def _dispatch(self, message, length, jMsg):
+        if self.m_dispatch_thread is None:
+            if self.m_OnReceive:
+                self.m_OnReceive(message, length, jMsg)
+            return
+
+        messageType = jMsg.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE)
+        with self.m_dispatch_cond:
+            policy = self.m_delivery_policies.get(messageType)
+            conflate_key = None
+            if policy and (policy[0] & DELIVERY_POLICY_CONFLATE):
+                conflate_key = (messageType, jMsg.get(ANDRUAV_PROTOCOL_SENDER, ""))
+                stale = self.m_conflate_pending.get(conflate_key)
+                if stale is not None:
+                    stale.m_dropped = True
+                    self._countDrop("conflate", messageType)
+            entry = CPendingMessage(message, length, jMsg, conflate_key)
+            if conflate_key is not None:
+                self.m_conflate_pending[conflate_key] = entry
+            while len(self.m_dispatch_queue) >= self.m_dispatch_queue_size:
+                oldest = self.m_dispatch_queue.popleft()
+                if oldest.m_dropped:
+                    continue
+                if oldest.m_conflate_key is not None:
+                    self.m_conflate_pending.pop(oldest.m_conflate_key, None)
+                self._countDrop("overflow", oldest.m_jMsg.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE))
+            self.m_dispatch_queue.append(entry)
+            self.m_dispatch_cond.notify()
+
+    def InternalDispatchEntry(self):
+        while True:
+            with self.m_dispatch_cond:
+                while not self.m_dispatch_queue and not self.m_dispatch_stopped:
+                    self.m_dispatch_cond.wait()
+                if self.m_dispatch_stopped:
+                    return
+                entry = self.m_dispatch_queue.popleft()
+                if entry.m_dropped:
+                    continue
+                if entry.m_conflate_key is not None:
+                    self.m_conflate_pending.pop(entry.m_conflate_key, None)
+
+                messageType = entry.m_jMsg.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE)
+                policy = self.m_delivery_policies.get(messageType)
+                if policy and (policy[0] & DELIVERY_POLICY_TTL) and (time.monotonic() - entry.m_received_at > policy[1]):
+                    self._countDrop("ttl", messageType)
+                    continue
+
+            if self.m_OnReceive:
+                try:
+                    self.m_OnReceive(entry.m_message, entry.m_length, entry.m_jMsg)
+                except Exception as e:
+                    print(f"ERROR:{e}")
+
     def add_module_features(self, feature):
         self.m_module_features.append(feature)
     
@@ -79,8 +340,155 @@ class CModule(object):
         self.m_hardware_serial = hardware_serial
         self.m_hardware_serial_type = hardware_serial_type
     
-    def sendMSG(self, msg, length):
-        self.cUDPClient.sendMSG(msg, length)
+    def sendMSG(self, msg, length, andruav_message_id=None):
+        if not self.m_link_connected and self._bufferOutbound(msg, length, andruav_message_id):
+            return
+        self._sendBehindFlush(lambda: self.cUDPClient.sendMSG(msg, length))
+
+    def isLinkConnected(self):
+        return self.m_link_connected
+
+    def setLivenessDeadline(self, deadline):
+        """Seconds without any message from de_comm before the link is considered down."""
+        self.m_liveness_deadline = deadline
+
+    def setOutageBuffer(self, max_messages, max_bytes=DEFAULT_OUTAGE_BUFFER_BYTES):
+        """Bound the buffer of outbound messages kept while de_comm is unreachable. 0 disables buffering."""
+        with self.m_outage_lock:
+            self.m_outage_max_messages = max_messages
+            self.m_outage_max_bytes = max_bytes
+
+    def setOutagePriority(self, andruav_message_id, priority):
+        """OUTAGE_PRIORITY_* used for messages of this type sent during an outage."""
+        self.m_outage_priorities[andruav_message_id] = priority
+
+    def getOutageStats(self):
+        """e.g. {"buffered": 3, "flushed": 40, "dropped": {OUTAGE_PRIORITY_DROP: 120}}"""
+        with self.m_outage_lock:
+            return {"buffered": self.m_outage_buffer_count,
+                    "flushed": self.m_outage_stats["flushed"],
+                    "dropped": dict(self.m_outage_stats["dropped"])}
+
+    def _countOutageDrop(self, priority):
+        dropped = self.m_outage_stats["dropped"]
+        dropped[priority] = dropped.get(priority, 0) + 1
+
+    def _bufferOutbound(self, msg, length, andruav_message_id):
+        """Keep a message sent during an outage. Returns False if it should be sent anyway."""
+        if andruav_message_id is None:
+            return False
+        priority = self.m_outage_priorities.get(andruav_message_id, OUTAGE_PRIORITY_NORMAL)
+        with self.m_outage_lock:
+            if self.m_link_connected:
+                return False
+            if priority == OUTAGE_PRIORITY_DROP or length > self.m_outage_max_bytes or self.m_outage_max_messages <= 0:
+                self._countOutageDrop(priority)
+                return True
+
+            while (self.m_outage_buffer_count >= self.m_outage_max_messages
+                   or self.m_outage_buffer_bytes + length > self.m_outage_max_bytes):
+                # oldest message of the lowest priority not above the new one.
+                victims = None
+                for buffered_priority in sorted(self.m_outage_buffer):
+                    if buffered_priority > priority:
+                        break
+                    if self.m_outage_buffer[buffered_priority]:
+                        victims = self.m_outage_buffer[buffered_priority]
+                        break
+                if victims is None:
+                    self._countOutageDrop(priority)
+                    return True
+                _, _, victim_length = victims.popleft()
+                self.m_outage_buffer_count -= 1
+                self.m_outage_buffer_bytes -= victim_length
+                self._countOutageDrop(buffered_priority)
+
+            self.m_outage_buffer.setdefault(priority, deque()).append((self.m_outage_sequence, msg, length))
+            self.m_outage_sequence += 1
+            self.m_outage_buffer_count += 1
+            self.m_outage_buffer_bytes += length
+        return True
+
+    def _flushOutbound(self):
+        """Send the outage buffer from a flush thread, so the receiver keeps draining the socket."""
+        with self.m_outage_cond:
+            if self.m_outage_buffer_count == 0 or self.m_outage_flush_thread is not None:
+                return
+            self.m_outage_flush_thread = threading.Thread(target=self.InternalFlushEntry, daemon=True)
+            self.m_outage_flush_thread.start()
+
+    def _sendBehindFlush(self, send):
+        """Call send() once the outage buffer is flushed, so new messages do not overtake it.
+
+        The receiver thread does not wait: a flush may depend on what it receives, so its
+        sends are queued and made by the flush thread when the buffer is empty.
+        """
+        with self.m_outage_cond:
+            if self.m_outage_flush_thread is not None and self.m_outage_flush_thread is not threading.current_thread():
+                if threading.current_thread() is self.cUDPClient.m_threadReceiver:
+                    self.m_outage_after_flush.append(send)
+                    return
+                while self.m_outage_flush_thread is not None:
+                    self.m_outage_cond.wait()
+        send()
+
+    def InternalFlushEntry(self):
+        while True:
+            with self.m_outage_cond:
+                # buffered messages are sent in the order they were sent, whatever their priority.
+                oldest = None
+                for messages in self.m_outage_buffer.values():
+                    if messages and (oldest is None or messages[0][0] < oldest[0][0]):
+                        oldest = messages
+                if oldest is not None:
+                    _, msg, length = oldest.popleft()
+                    self.m_outage_buffer_count -= 1
+                    self.m_outage_buffer_bytes -= length
+                    self.m_outage_stats["flushed"] += 1
+                    send = lambda: self.cUDPClient.sendMSG(msg, length)
+                elif self.m_outage_after_flush:
+                    send = self.m_outage_after_flush.popleft()
+                else:
+                    self.m_outage_flush_thread = None
+                    self.m_outage_cond.notify_all()
+                    return
+            try:
+                send()
+            except Exception as e:
+                print(f"ERROR:{e}")
+
+    def _onLinkTick(self):
+        """Called before each ID message: detect outages and back the heartbeat off while stable.
+
+        de_comm only replies to IDs that ask for it (JSON_INTERMODULE_RESEND). A link silent for
+        half the deadline is probed with those, and is lost only if no probe gets a reply.
+        """
+        if not self.m_link_connected:
+            return
+        silent = time.monotonic() - self.m_last_received
+        if silent > self.m_liveness_deadline:
+            with self.m_outage_lock:
+                self.m_link_connected = False
+            print(f" ** Communicator Server Lost: no message for {self.m_liveness_deadline}s")
+            self.m_FirstReceived = False
+            self.m_link_probing = False
+            self.createJSONID(True)
+            self.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL)
+            return
+        if silent > self.m_liveness_deadline / 2:
+            if not self.m_link_probing:
+                self.m_link_probing = True
+                self.createJSONID(True)
+                self.cUDPClient.setIdInterval(LINK_ID_RETRY_INTERVAL)
+            return
+        if self.m_link_probing:
+            self.m_link_probing = False
+            self.createJSONID(False)
+        self.m_heartbeat_interval = min(self.m_heartbeat_interval * 2, LINK_HEARTBEAT_INTERVAL_MAX,
+                                        self.m_liveness_deadline / 2)
+        # the next ID goes out no later than when probing should start.
+        self.cUDPClient.setIdInterval(max(LINK_ID_RETRY_INTERVAL,
+                                          min(self.m_heartbeat_interval, self.m_liveness_deadline / 2 - silent)))
     
     def send_sys_msg(self, jmsg, andruav_message_id):
         full_message = {
@@ -93,7 +501,7 @@ class CModule(object):
         self.send_msg(msg.encode(), len(msg))
 
     
-    def sendJMSG(self, targetPartyID, jmsg, andruav_message_id, internal_message):
+    def sendJMSG(self, targetPartyID, jmsg, andruav_message_id, internal_message, correlation_id=None):
         """Generate and sends JSON text string
 
         Args:
@@ -101,6 +509,7 @@ class CModule(object):
             jmsg (_type_): _description_
             andruav_message_id (_type_): _description_
             internal_message (_type_): _description_
+            correlation_id (str, optional): stamped into the envelope so a reply can be matched to its request.
         """
         with self.m_lock:
             fullMessage = {}
@@ -116,10 +525,91 @@ class CModule(object):
             fullMessage[INTERMODULE_ROUTING_TYPE] = msg_routing_type
             fullMessage[ANDRUAV_PROTOCOL_MESSAGE_TYPE] = andruav_message_id
             fullMessage[ANDRUAV_PROTOCOL_MESSAGE_CMD] = jmsg
+            if correlation_id is not None:
+                fullMessage[ANDRUAV_PROTOCOL_CORRELATION_ID] = correlation_id
 
             msg = json.dumps(fullMessage)
             print(f"sendJMSG: {msg}")
-            self.sendMSG(msg.encode(), len(msg))
+            self.sendMSG(msg.encode(), len(msg), andruav_message_id)
+
+    def request(self, targetPartyID, jmsg, andruav_message_id, timeout=DEFAULT_REQUEST_TIMEOUT,
+                reply_message_id=None, internal_message=False, callback=None):
+        """Send a JSON request and return a Future resolved with the reply message.
+
+        The reply is matched on the receive thread by the correlation id echoed
+        back by the replying module (see replyJMSG). Modules that do not echo
+        the id can still be matched by passing reply_message_id: the oldest
+        pending request for that reply type from targetPartyID is resolved.
+        The future fails with TimeoutError when no reply arrives in time.
+
+        Args:
+            targetPartyID (str): destination unit partyid
+            jmsg (dict): message body
+            andruav_message_id (int): request message type
+            timeout (float): seconds to wait for the reply
+            reply_message_id (int, optional): expected reply message type
+            internal_message (bool): send as inter-module message
+            callback (callable, optional): called as callback(jMsg, error) when done
+        """
+        future = Future()
+        with self.m_requests_lock:
+            self.m_request_counter += 1
+            correlation_id = f"{self.m_module_key}:{self.m_request_counter}"
+            request = CPendingRequest(correlation_id, targetPartyID, reply_message_id, future)
+            self.m_pending_requests[correlation_id] = request
+            request.m_timer = self.m_timer_wheel.schedule(timeout, lambda: self._expireRequest(correlation_id))
+
+        if callback:
+            def onDone(f):
+                if f.cancelled():
+                    callback(None, TimeoutError("request cancelled"))
+                elif f.exception() is not None:
+                    callback(None, f.exception())
+                else:
+                    callback(f.result(), None)
+            future.add_done_callback(onDone)
+
+        self.sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message, correlation_id)
+        return future
+
+    def replyJMSG(self, requestJMsg, jmsg, andruav_message_id, internal_message=False):
+        """Reply to a received request, echoing its correlation id back to the sender."""
+        targetPartyID = requestJMsg.get(ANDRUAV_PROTOCOL_SENDER, "")
+        correlation_id = requestJMsg.get(ANDRUAV_PROTOCOL_CORRELATION_ID)
+        self.sendJMSG(targetPartyID, jmsg, andruav_message_id, internal_message, correlation_id)
+
+    def _expireRequest(self, correlation_id):
+        with self.m_requests_lock:
+            request = self.m_pending_requests.pop(correlation_id, None)
+        if request and not request.m_future.done():
+            request.m_future.set_exception(TimeoutError(f"request {correlation_id} timed out"))
+
+    def _matchReply(self, jMsg):
+        """Resolve the pending request this message replies to. Returns True if consumed."""
+        with self.m_requests_lock:
+            if not self.m_pending_requests:
+                return False
+            request = None
+            correlation_id = jMsg.get(ANDRUAV_PROTOCOL_CORRELATION_ID)
+            if correlation_id is not None:
+                request = self.m_pending_requests.pop(correlation_id, None)
+            else:
+                messageType = jMsg.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE)
+                sender = jMsg.get(ANDRUAV_PROTOCOL_SENDER, "")
+                for key, pending in self.m_pending_requests.items():
+                    if pending.m_reply_message_id != messageType:
+                        continue
+                    if pending.m_target_party_id and pending.m_target_party_id != sender:
+                        continue
+                    request = self.m_pending_requests.pop(key)
+                    break
+            if request is None:
+                return False
+            request.m_timer.cancel()
+
+        if not request.m_future.done():
+            request.m_future.set_result(jMsg)
+        return True
 
     def sendBMSG(self, targetPartyID, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd):
         with self.m_lock:
@@ -144,7 +634,70 @@ class CModule(object):
             if bmsg_length:
                 msg += bmsg
 
-            self.sendMSG(msg, len(msg))
+            self.sendMSG(msg, len(msg), andruav_message_id)
+
+    def _fanOutHead(self, targetPartyID, andruav_message_id, internal_message):
+        """Envelope text up to the body, for one target."""
+        msg_routing_type = CMD_COMM_GROUP
+        if internal_message:
+            msg_routing_type = CMD_TYPE_INTERMODULE
+        elif targetPartyID:
+            msg_routing_type = CMD_COMM_INDIVIDUAL
+
+        envelope = json.dumps({
+            INTERMODULE_MODULE_KEY: self.m_module_key,
+            ANDRUAV_PROTOCOL_TARGET_ID: targetPartyID,
+            INTERMODULE_ROUTING_TYPE: msg_routing_type,
+            ANDRUAV_PROTOCOL_MESSAGE_TYPE: andruav_message_id
+        })
+        return (envelope[:-1] + f', "{ANDRUAV_PROTOCOL_MESSAGE_CMD}": ').encode()
+
+    def _sendFanOut(self, targetPartyIDs, tail, andruav_message_id, internal_message):
+        heads = [self._fanOutHead(target, andruav_message_id, internal_message) for target in targetPartyIDs]
+        if not self.m_link_connected:
+            # buffered one by one during an outage.
+            for head in heads:
+                msg = head + tail
+                self.sendMSG(msg, len(msg), andruav_message_id)
+            return
+        self._sendBehindFlush(lambda: self.cUDPClient.sendFanOut(heads, tail))
+
+    def sendJMSGMulti(self, targetPartyIDs, jmsg, andruav_message_id, internal_message=False):
+        """sendJMSG() to each of targetPartyIDs.
+
+        The body is serialized and chunked once, only the first chunk, which holds the
+        routing header, is built per target.
+        """
+        with self.m_lock:
+            tail = (json.dumps(jmsg) + "}").encode()
+            self._sendFanOut(targetPartyIDs, tail, andruav_message_id, internal_message)
+
+    def sendBMSGMulti(self, targetPartyIDs, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd):
+        """sendBMSG() to each of targetPartyIDs, the binary payload is chunked once."""
+        with self.m_lock:
+            tail = (json.dumps(message_cmd) + "}").encode() + b'\0'
+            if bmsg_length:
+                tail += bmsg
+            self._sendFanOut(targetPartyIDs, tail, andruav_message_id, internal_message)
+
+    def addPeriodicPublisher(self, rate, producer):
+        """Call producer() rate times per second, e.g. to send a telemetry stream.
+
+        Producers run on one publisher thread on drift free deadlines; producers with the
+        same rate share a wakeup. They start once the module is initialized.
+        Returns an id for setPublisherRate(), getPublisherStats() and removePeriodicPublisher().
+        """
+        return self.m_publisher.addPublisher(rate, producer)
+
+    def removePeriodicPublisher(self, publisher_id):
+        return self.m_publisher.removePublisher(publisher_id)
+
+    def setPublisherRate(self, publisher_id, rate):
+        return self.m_publisher.setRate(publisher_id, rate)
+
+    def getPublisherStats(self, publisher_id):
+        """rate, runs, overruns (skipped periods) and jitter_last/max/mean in seconds."""
+        return self.m_publisher.getStats(publisher_id)
 
     def sendMREMSG(self, command_type):
         with self.m_lock:
@@ -156,11 +709,123 @@ class CModule(object):
             }
 
             msg = json.dumps(json_msg)
-            self.sendMSG(msg.encode(), len(msg))
+            self.sendMSG(msg.encode(), len(msg), TYPE_AndruavModule_RemoteExecute)
 
     def forwardMSG(self, message, datalength):
         self.sendMSG(message, datalength)
 
+    def addForwardingRule(self, message_types=None, target_party_id=None, transport=None, rewrite=None):
+        """Relay received messages of message_types and/or addressed to target_party_id.
+
+        Matching messages are retransmitted chunk by chunk as they arrive, without waiting
+        for the whole message, and are not delivered to m_OnReceive.
+        transport: where to relay, this module's own transport (de_comm) by default.
+        rewrite(jHeader) returns the envelope to send instead, e.g. with another target.
+        Returns a rule id for removeForwardingRule().
+        """
+        rule = CForwardingRule(message_types, target_party_id, transport, rewrite)
+        with self.m_lock:
+            self.m_forwarding_rule_counter += 1
+            self.m_forwarding_rules[self.m_forwarding_rule_counter] = rule
+            return self.m_forwarding_rule_counter
+
+    def removeForwardingRule(self, rule_id):
+        with self.m_lock:
+            self.m_forwarding_rules.pop(rule_id, None)
+
+    def getForwardingStats(self):
+        """{"cut_through": n, "stored": n} messages relayed chunk by chunk, or after reassembly
+        because their envelope did not fit in the first chunk."""
+        return dict(self.m_forward_stats)
+
+    def _matchForwardingRule(self, jHeader):
+        if jHeader.get(INTERMODULE_ROUTING_TYPE) == CMD_TYPE_INTERMODULE:
+            return None
+        with self.m_lock:
+            for rule in self.m_forwarding_rules.values():
+                if rule.matches(jHeader):
+                    return rule
+        return None
+
+    @staticmethod
+    def _splitEnvelope(data, offset, complete):
+        """Parse the JSON envelope at data[offset:] up to the binary separator.
+
+        Returns (jHeader, end) or (None, -1) if the envelope is not all in data.
+        """
+        end = data.find(b'\0', offset)
+        if end == -1:
+            if not complete:
+                return None, -1
+            end = len(data)
+        try:
+            return json.loads(data[offset:end]), end
+        except ValueError:
+            return None, -1
+
+    def _rewriteEnvelope(self, rule, data, offset, jHeader, end):
+        """Envelope to relay: rewritten by the rule, sent with this module's key."""
+        if rule.m_rewrite is not None:
+            jHeader = rule.m_rewrite(jHeader)
+        elif jHeader.get(INTERMODULE_MODULE_KEY) == self.m_module_key:
+            return data
+        jHeader[INTERMODULE_MODULE_KEY] = self.m_module_key
+        header = json.dumps(jHeader).encode()
+        return data[:offset] + header + data[end:]
+
+    @staticmethod
+    def _isEnvelope(datagram):
+        """True if a last chunk holds a whole message of its own rather than a tail."""
+        if datagram[UDP_CHUNK_HEADER_SIZE:UDP_CHUNK_HEADER_SIZE + 1] != b'{':
+            return False
+        jHeader, _ = CModule._splitEnvelope(datagram, UDP_CHUNK_HEADER_SIZE, True)
+        return isinstance(jHeader, dict) and ANDRUAV_PROTOCOL_MESSAGE_TYPE in jHeader
+
+    def _onChunk(self, datagram, chunk_number, first):
+        """Receiver thread hook: relays chunks of messages that match a forwarding rule."""
+        rule = self.m_forward_rule
+        if rule is not None:
+            transport = rule.m_transport or self.cUDPClient
+            if chunk_number == 0 or not transport.isForwarding() \
+                    or (chunk_number == UDP_LAST_CHUNK_NUMBER and self._isEnvelope(datagram)):
+                # the relayed message lost its tail: a new message started or the relay timed out.
+                self.m_forward_rule = None
+                transport.endForwardSession()
+            else:
+                transport.forwardDatagram(datagram, False)
+                if chunk_number == UDP_LAST_CHUNK_NUMBER:
+                    self.m_forward_rule = None
+                return True
+
+        if not self.m_forwarding_rules or not first or chunk_number not in (0, UDP_LAST_CHUNK_NUMBER):
+            return False
+
+        last = chunk_number == UDP_LAST_CHUNK_NUMBER
+        jHeader, end = self._splitEnvelope(datagram, UDP_CHUNK_HEADER_SIZE, last)
+        if jHeader is None:
+            # envelope continues in the next chunk, onReceive() forwards it after reassembly.
+            return False
+        rule = self._matchForwardingRule(jHeader)
+        if rule is None:
+            return False
+
+        datagram = self._rewriteEnvelope(rule, datagram, UDP_CHUNK_HEADER_SIZE, jHeader, end)
+        (rule.m_transport or self.cUDPClient).forwardDatagram(datagram, True)
+        if not last:
+            self.m_forward_rule = rule
+        self.m_forward_stats["cut_through"] += 1
+        return True
+
+    def _forwardReassembled(self, message, jMsg):
+        rule = self._matchForwardingRule(jMsg)
+        if rule is None:
+            return False
+        jHeader, end = self._splitEnvelope(message, 0, True)
+        message = self._rewriteEnvelope(rule, message, 0, jHeader, end)
+        (rule.m_transport or self.cUDPClient).sendMSG(message, len(message))
+        self.m_forward_stats["stored"] += 1
+        return True
+
     def onReceive(self, message, len):
         print(f"RX MSG: :len {len}:{message}")
 
@@ -169,6 +834,8 @@ class CModule(object):
 
             print(f"RX MSG: jMsg{json.dumps(jMsg)}")
 
+            self.m_last_received = time.monotonic()
+
             if ANDRUAV_PROTOCOL_MESSAGE_TYPE not in jMsg:
                 return
             if INTERMODULE_ROUTING_TYPE not in jMsg:
@@ -194,10 +861,18 @@ class CModule(object):
                     self.m_party_id = moduleID[ANDRUAV_PROTOCOL_SENDER]
                     self.m_group_id = moduleID[ANDRUAV_PROTOCOL_GROUP_ID]
 
+                    if JSON_INTERMODULE_CHUNK_SIZE in cmd:
+                        self.cUDPClient.negotiateChunkSize(int(cmd[JSON_INTERMODULE_CHUNK_SIZE]))
+
                     if not self.m_FirstReceived:
                         print(f" ** Communicator Server Found: m_party_id({self.m_party_id}) m_group_id({self.m_group_id})")
                         self.createJSONID(False)
                         self.m_FirstReceived = True
+                        self.m_heartbeat_interval = LINK_HEARTBEAT_INTERVAL_MIN
+                        self.cUDPClient.setIdInterval(self.m_heartbeat_interval)
+                        with self.m_outage_lock:
+                            self.m_link_connected = True
+                        self._flushOutbound()
 
                     if self.m_OnReceive:
                         self.m_OnReceive(message, len, jMsg)
@@ -207,8 +882,13 @@ class CModule(object):
                 elif messageType == TYPE_AndruavMessage_DUMMY:
                     print(f" TYPE_AndruavMessage_DUMMY {message}")
 
-            if self.m_OnReceive:
-                self.m_OnReceive(message, len, jMsg)
+            if self.m_forwarding_rules and self._forwardReassembled(message, jMsg):
+                return
+
+            if self._matchReply(jMsg):
+                return
+
+            self._dispatch(message, len, jMsg)
 
         except Exception as e:
             print(f"ERROR:{e}")
@@ -233,6 +913,7 @@ class CModule(object):
         ms[JSON_INTERMODULE_VERSION] = self.m_module_version
         ms[JSON_INTERMODULE_RESEND] = reSend
         ms[JSON_INTERMODULE_TIMESTAMP_INSTANCE] = self.m_instance_time_stamp
+        ms[JSON_INTERMODULE_CHUNK_SIZE] = self.cUDPClient.m_localChunkSize
         
         for key, value in self.m_stdinValues.items():
             ms[key] = value
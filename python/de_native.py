@@ -0,0 +1,216 @@
+"""
+ctypes binding for the native DroneEngage databus library (client/src/de_capi).
+Drop-in alternative to CModule that uses the C++ chunking, pacing and
+reassembly engine instead of the pure Python transport in udpClient.py.
+"""
+
+import ctypes
+import ctypes.util
+import json
+import os
+import threading
+
+from transport import UDP_DATABUS_PACKET_SIZE_AUTO
+
+
+DE_CAPI_OK = 0
+
+ON_RECEIVE_FUNC = ctypes.CFUNCTYPE(None, ctypes.POINTER(ctypes.c_char), ctypes.c_int, ctypes.c_void_p)
+ON_MESSAGE_FUNC = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_void_p)
+
+
+def _find_library():
+    path = os.environ.get("DE_DATABUS_LIBRARY")
+    if path:
+        return path
+    local = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "client", "bin", "libdroneengage_databus.so")
+    if os.path.exists(local):
+        return local
+    return ctypes.util.find_library("droneengage_databus")
+
+
+def _load_library(path):
+    lib = ctypes.CDLL(path)
+    lib.de_capi_version.restype = ctypes.c_int
+    lib.de_module_define.argtypes = [ctypes.c_char_p] * 5
+    lib.de_module_add_feature.argtypes = [ctypes.c_char_p]
+    lib.de_module_set_hardware.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    lib.de_module_set_on_receive.argtypes = [ON_RECEIVE_FUNC, ctypes.c_void_p]
+    lib.de_module_set_on_message.argtypes = [ON_MESSAGE_FUNC, ctypes.c_void_p]
+    lib.de_message_retain.argtypes = [ctypes.c_void_p]
+    lib.de_message_retain.restype = ctypes.c_void_p
+    lib.de_message_release.argtypes = [ctypes.c_void_p]
+    lib.de_message_release.restype = None
+    for name in ("de_message_data", "de_message_header", "de_message_payload"):
+        getattr(lib, name).argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int)]
+        getattr(lib, name).restype = ctypes.c_void_p
+    lib.de_message_type.argtypes = [ctypes.c_void_p]
+    lib.de_message_type.restype = ctypes.c_int
+    lib.de_module_init.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+    lib.de_module_send_jmsg.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+    lib.de_module_send_bmsg.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_char_p]
+    for name in ("de_module_define", "de_module_add_feature", "de_module_set_hardware", "de_module_set_on_receive",
+                 "de_module_set_on_message", "de_module_init", "de_module_uninit", "de_module_send_jmsg", "de_module_send_bmsg"):
+        getattr(lib, name).restype = ctypes.c_int
+    return lib
+
+
+class CNativeMessage(object):
+    """A received message owning one reference to the library's pooled buffer.
+
+    header, payload and data are memoryviews over the native buffer, nothing is copied.
+    A view keeps its message alive, but release() frees the buffer under it: do not call
+    release() while views are in use.
+    """
+
+    def __init__(self, lib, handle):
+        self.m_lib = lib
+        self.m_handle = handle
+        self.m_body = None
+
+    def __del__(self):
+        self.release()
+
+    def _view(self, accessor):
+        if not self.m_handle:
+            raise ValueError("message released")
+        length = ctypes.c_int(0)
+        address = accessor(self.m_handle, ctypes.byref(length))
+        if length.value == 0:
+            return memoryview(b'')
+        buffer = (ctypes.c_char * length.value).from_address(address)
+        # the view keeps the message, and so the pooled buffer, alive.
+        buffer._owner = self
+        return memoryview(buffer).cast('B')
+
+    @property
+    def data(self):
+        return self._view(self.m_lib.de_message_data)
+
+    @property
+    def header(self):
+        """The JSON envelope, without the '\\0' separator."""
+        return self._view(self.m_lib.de_message_header)
+
+    @property
+    def payload(self):
+        """The binary payload, empty for JSON only messages."""
+        return self._view(self.m_lib.de_message_payload)
+
+    @property
+    def body(self):
+        """The parsed envelope, parsed on first access."""
+        if self.m_body is None:
+            self.m_body = json.loads(self.header.tobytes())
+        return self.m_body
+
+    def messageType(self):
+        return self.m_lib.de_message_type(self.m_handle) if self.m_handle else -1
+
+    def retain(self):
+        """Another, independently released, reference to the same buffer."""
+        if not self.m_handle:
+            raise ValueError("message released")
+        return CNativeMessage(self.m_lib, self.m_lib.de_message_retain(self.m_handle))
+
+    def release(self):
+        """Return the buffer to the pool once all references are released. Called by the garbage collector too."""
+        handle, self.m_handle = self.m_handle, None
+        if handle:
+            self.m_lib.de_message_release(handle)
+
+
+class CNativeModule(object):
+    """Same API as CModule, backed by libdroneengage_databus.so."""
+
+    _instance = None
+    _lock = threading.Lock()
+
+    def __new__(cls, *args, **kwargs):
+        if cls._instance is None:
+            with cls._lock:
+                if cls._instance is None:
+                    cls._instance = super(CNativeModule, cls).__new__(cls)
+                    cls._instance.m_lib = None
+        return cls._instance
+
+    def __init__(self, library_path=None):
+        if self.m_lib is not None:
+            return
+        path = library_path or _find_library()
+        if not path:
+            raise OSError("libdroneengage_databus.so not found, build client/ or set DE_DATABUS_LIBRARY")
+        self.m_lib = _load_library(path)
+        self.m_OnReceive = None
+        self.m_OnReceiveEx = None
+        # keep a reference, ctypes does not own the callback.
+        self.m_native_callback = ON_RECEIVE_FUNC(self._onNativeReceive)
+        self.m_native_message_callback = ON_MESSAGE_FUNC(self._onNativeMessage)
+
+    def defineModule(self, module_class, module_id, module_key, module_version, message_filter):
+        self._check(self.m_lib.de_module_define(module_class.encode(), module_id.encode(), module_key.encode(),
+                                                module_version.encode(), json.dumps(message_filter).encode()))
+
+    def add_module_features(self, feature):
+        self._check(self.m_lib.de_module_add_feature(feature.encode()))
+
+    def set_hardware(self, hardware_serial, hardware_serial_type):
+        self._check(self.m_lib.de_module_set_hardware(hardware_serial.encode(), int(hardware_serial_type)))
+
+    def setMessageOnReceive(self, callback):
+        """callback(message: bytes, length: int, jMsg: dict)"""
+        self.m_OnReceive = callback
+        self._check(self.m_lib.de_module_set_on_receive(self.m_native_callback, None))
+
+    def setMessageOnReceiveEx(self, callback):
+        """callback(message: CNativeMessage) receives an owned message instead of a copy.
+
+        The message can be kept or queued to another thread; its buffer returns to the
+        library's pool when it is released or garbage collected.
+        """
+        self.m_OnReceiveEx = callback
+        self._check(self.m_lib.de_module_set_on_message(self.m_native_message_callback, None))
+
+    def init(self, target_ip, broadcasts_port, host, listening_port, chunk_size=UDP_DATABUS_PACKET_SIZE_AUTO):
+        """chunk_size: UDP_DATABUS_PACKET_SIZE_AUTO (0) lets the library choose it, any other value pins it."""
+        self._check(self.m_lib.de_module_init(target_ip.encode(), broadcasts_port, host.encode(), listening_port, chunk_size))
+        return True
+
+    def uninit(self):
+        self._check(self.m_lib.de_module_uninit())
+        return True
+
+    def sendJMSG(self, targetPartyID, jmsg, andruav_message_id, internal_message):
+        self._check(self.m_lib.de_module_send_jmsg(targetPartyID.encode(), json.dumps(jmsg).encode(),
+                                                   andruav_message_id, 1 if internal_message else 0))
+
+    def sendBMSG(self, targetPartyID, bmsg, bmsg_length, andruav_message_id, internal_message, message_cmd):
+        self._check(self.m_lib.de_module_send_bmsg(targetPartyID.encode(), bytes(bmsg[:bmsg_length]), bmsg_length,
+                                                   andruav_message_id, 1 if internal_message else 0,
+                                                   json.dumps(message_cmd).encode()))
+
+    def _onNativeReceive(self, message, length, user_data):
+        if not self.m_OnReceive:
+            return
+        try:
+            data = ctypes.string_at(message, length)
+            header_end = data.find(b'\0')
+            header = data if header_end == -1 else data[:header_end]
+            self.m_OnReceive(data, length, json.loads(header))
+        except Exception as e:
+            print(f"ERROR:{e}")
+
+    def _onNativeMessage(self, handle, user_data):
+        message = CNativeMessage(self.m_lib, handle)
+        if not self.m_OnReceiveEx:
+            message.release()
+            return
+        try:
+            self.m_OnReceiveEx(message)
+        except Exception as e:
+            print(f"ERROR:{e}")
+
+    @staticmethod
+    def _check(result):
+        if result != DE_CAPI_OK:
+            raise RuntimeError(f"de_capi call failed ({result})")
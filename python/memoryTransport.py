@@ -0,0 +1,101 @@
+import queue
+import threading
+
+from transport import *
+
+
+class CMemoryNetwork(object):
+    """In-process datagram network connecting CMemoryTransport endpoints.
+
+    Endpoints are addressed by port only, so "0.0.0.0", "127.0.0.1" and any other
+    host name reach the same endpoint. Datagrams sent to a port nobody listens on
+    are dropped, like UDP.
+    """
+
+    def __init__(self):
+        self.m_endpoints = {}
+        self.m_lock = threading.Lock()
+        self.m_stats = {"delivered": 0, "unreachable": 0}
+
+    def attach(self, port, endpoint):
+        with self.m_lock:
+            if port in self.m_endpoints:
+                raise Exception(f"Port {port} already in use")
+            self.m_endpoints[port] = endpoint
+
+    def detach(self, port):
+        with self.m_lock:
+            self.m_endpoints.pop(port, None)
+
+    def deliver(self, address, datagram):
+        with self.m_lock:
+            endpoint = self.m_endpoints.get(address[1])
+            if endpoint is None:
+                self.m_stats["unreachable"] += 1
+                return False
+            self.m_stats["delivered"] += 1
+        endpoint.put(bytes(datagram))
+        return True
+
+    def waitIdle(self):
+        """Wait until every datagram delivered so far has been processed by its receiver,
+        including the datagrams those receivers sent in turn.
+
+        Every endpoint must have its receiver running.
+        """
+        while True:
+            with self.m_lock:
+                busy = [endpoint for endpoint in self.m_endpoints.values() if endpoint.unfinished_tasks]
+            if not busy:
+                return
+            for endpoint in busy:
+                endpoint.join()
+
+    def getStats(self):
+        with self.m_lock:
+            return dict(self.m_stats)
+
+
+class CMemoryTransport(CTransport):
+    """CTransport over a CMemoryNetwork. Connects modules inside one process without sockets.
+
+    Chunks are not paced by default, the network never loses them.
+    """
+
+    def __init__(self, network):
+        super().__init__()
+        self.m_network = network
+        self.m_queue = None
+        self.m_received = False
+        self.m_chunkPacing = 0
+
+    def detectChunkSize(self, targetIP, targetPort):
+        return UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE
+
+    def open(self):
+        self.m_queue = queue.Queue()
+        self.m_received = False
+        self.m_network.attach(self.m_ModuleAddress[1], self.m_queue)
+
+    def close(self):
+        if self.m_queue is not None:
+            self.m_network.detach(self.m_ModuleAddress[1])
+            self.m_queue = None
+
+    def sendDatagram(self, datagram):
+        self.m_network.deliver(self.m_CommunicatorModuleAddress, datagram)
+
+    def receiveDatagram(self, timeout):
+        receive_queue = self.m_queue
+        if receive_queue is None:
+            raise Exception("Transport closed")
+        if self.m_received:
+            # called again once the previous datagram is processed, see CMemoryNetwork.waitIdle().
+            self.m_received = False
+            receive_queue.task_done()
+        try:
+            datagram = receive_queue.get(timeout=timeout)
+        except queue.Empty:
+            return None
+        self.m_received = True
+        return datagram
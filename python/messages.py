@@ -14,6 +14,7 @@ JSON_INTERMODULE_HARDWARE_TYPE = "t"
 JSON_INTERMODULE_VERSION = "v"
 JSON_INTERMODULE_TIMESTAMP_INSTANCE = "u"
 JSON_INTERMODULE_RESEND = "z"
+JSON_INTERMODULE_CHUNK_SIZE = "k"
 
 # Communication Commands
 CMD_COMM_GROUP = "g"
@@ -29,6 +30,7 @@ ANDRUAV_PROTOCOL_MESSAGE_CMD = "ms"
 ANDRUAV_PROTOCOL_MESSAGE_PERMISSION = "p"
 INTERMODULE_ROUTING_TYPE = "ty"
 INTERMODULE_MODULE_KEY = "GU"
+ANDRUAV_PROTOCOL_CORRELATION_ID = "ci"
 
 # Reserved Target Values
 ANDRUAV_PROTOCOL_SENDER_ALL_GCS = "_GCS_"
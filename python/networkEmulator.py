@@ -0,0 +1,206 @@
+import heapq
+import random
+import threading
+import time
+
+from transport import *
+
+
+NETWORK_IMPAIRMENTS = ("loss", "duplicate", "reorder", "reorder_delay", "delay", "jitter", "rate", "queue_bytes")
+
+
+class CVirtualClock(object):
+    """Simulated time for CNetworkEmulator, in seconds from 0.
+
+    Time only moves when advance() is called. Datagrams are then delivered in the
+    order of their arrival times, so the delivery order depends on the seed and the
+    sequence of sends, never on thread scheduling.
+    """
+
+    def __init__(self):
+        self.m_now = 0.0
+        self.m_events = []
+        self.m_sequence = 0
+        self.m_lock = threading.Lock()
+
+    def now(self):
+        with self.m_lock:
+            return self.m_now
+
+    def schedule(self, when, callback):
+        """callback() runs inside the advance() call that reaches when."""
+        with self.m_lock:
+            self.m_sequence += 1
+            heapq.heappush(self.m_events, (when, self.m_sequence, callback))
+
+    def nextEventTime(self):
+        """Time of the earliest scheduled callback, None if there is none."""
+        with self.m_lock:
+            return self.m_events[0][0] if self.m_events else None
+
+    def advance(self, seconds):
+        """Move time forward, running the callbacks due on the way in time order."""
+        with self.m_lock:
+            target = self.m_now + seconds
+        while True:
+            with self.m_lock:
+                if not self.m_events or self.m_events[0][0] > target:
+                    self.m_now = target
+                    return
+                when, _, callback = heapq.heappop(self.m_events)
+                self.m_now = max(self.m_now, when)
+            callback()
+
+
+class CNetworkEmulator(CTransport):
+    """Decorates a CTransport with network impairments on the datagrams it sends.
+
+    Impairments are drawn from a random generator seeded with seed, so the same
+    sequence of sends is lost, duplicated and reordered the same way on every run.
+
+        loss            probability a datagram is dropped
+        duplicate       probability a datagram is delivered twice
+        reorder         probability a datagram is held back by reorder_delay seconds
+        delay, jitter   one way delay in seconds, plus uniform [0, jitter) seconds
+        rate            link rate in bytes per second, 0 is unlimited
+        queue_bytes     bytes waiting for the link beyond which datagrams are dropped
+
+    Received datagrams are passed through; decorate both ends to impair both directions.
+
+    With a CVirtualClock, datagrams are delivered when the clock is advanced, on the
+    thread calling advance(). Otherwise they are delivered in real time by a thread.
+    """
+
+    def __init__(self, transport, seed=0, loss=0.0, duplicate=0.0, reorder=0.0, reorder_delay=0.01,
+                 delay=0.0, jitter=0.0, rate=0, queue_bytes=1024 * 1024, clock=None):
+        super().__init__()
+        self.m_transport = transport
+        self.m_clock = clock
+        self.m_chunkPacing = transport.m_chunkPacing
+        self.m_random = random.Random(seed)
+        self.m_loss = loss
+        self.m_duplicate = duplicate
+        self.m_reorder = reorder
+        self.m_reorder_delay = reorder_delay
+        self.m_delay = delay
+        self.m_jitter = jitter
+        self.m_rate = rate
+        self.m_queue_bytes = queue_bytes
+        self.m_link_free_at = 0
+        self.m_in_flight = []
+        self.m_sequence = 0
+        self.m_cond = threading.Condition()
+        self.m_thread = None
+        self.m_closed = False
+        self.m_stats = {"sent": 0, "delivered": 0, "lost": 0, "queue_dropped": 0,
+                        "duplicated": 0, "reordered": 0}
+
+    def configure(self, **impairments):
+        """Change impairments at runtime e.g. configure(loss=1.0) to cut the link."""
+        with self.m_cond:
+            for name, value in impairments.items():
+                if name not in NETWORK_IMPAIRMENTS:
+                    raise Exception(f"Unknown impairment {name}")
+                setattr(self, "m_" + name, value)
+
+    def getStats(self):
+        with self.m_cond:
+            return dict(self.m_stats)
+
+    def detectChunkSize(self, targetIP, targetPort):
+        return self.m_transport.detectChunkSize(targetIP, targetPort)
+
+    def open(self):
+        self.m_transport.m_ModuleAddress = self.m_ModuleAddress
+        self.m_transport.m_CommunicatorModuleAddress = self.m_CommunicatorModuleAddress
+        self.m_transport.open()
+        self.m_closed = False
+        if self.m_clock is None:
+            self.m_thread = threading.Thread(target=self.InternalDeliveryEntry)
+            self.m_thread.start()
+
+    def close(self):
+        with self.m_cond:
+            self.m_closed = True
+            self.m_cond.notify()
+        if self.m_thread and self.m_thread is not threading.current_thread():
+            self.m_thread.join(timeout=1.0)
+        self.m_transport.close()
+
+    def receiveDatagram(self, timeout):
+        return self.m_transport.receiveDatagram(timeout)
+
+    def sendDatagram(self, datagram):
+        length = len(datagram)
+        with self.m_cond:
+            # fixed number of draws per datagram keeps runs aligned whatever the settings.
+            lost = self.m_random.random() < self.m_loss
+            duplicated = self.m_random.random() < self.m_duplicate
+            reordered = self.m_random.random() < self.m_reorder
+            jitter = self.m_random.random() * self.m_jitter
+
+            self.m_stats["sent"] += 1
+            if lost:
+                self.m_stats["lost"] += 1
+                return
+
+            now = self.m_clock.now() if self.m_clock is not None else time.monotonic()
+            departure = now
+            if self.m_rate > 0:
+                start = max(now, self.m_link_free_at)
+                if (start - now) * self.m_rate + length > self.m_queue_bytes:
+                    self.m_stats["queue_dropped"] += 1
+                    return
+                departure = start + length / self.m_rate
+                self.m_link_free_at = departure
+
+            arrival = departure + self.m_delay + jitter
+            if reordered:
+                arrival += self.m_reorder_delay
+                self.m_stats["reordered"] += 1
+
+            self._schedule(arrival, bytes(datagram))
+            if duplicated:
+                self.m_stats["duplicated"] += 1
+                self._schedule(arrival, bytes(datagram))
+            self.m_cond.notify()
+
+    def _schedule(self, arrival, datagram):
+        if self.m_clock is not None:
+            self.m_clock.schedule(arrival, lambda: self._deliver(datagram))
+            return
+        self.m_sequence += 1
+        heapq.heappush(self.m_in_flight, (arrival, self.m_sequence, datagram))
+
+    def _deliver(self, datagram):
+        """Virtual clock delivery, called by CVirtualClock.advance()."""
+        with self.m_cond:
+            if self.m_closed:
+                return
+            self.m_stats["delivered"] += 1
+        try:
+            self.m_transport.sendDatagram(datagram)
+        except Exception as e:
+            print(f"Error in network emulator: {e}")
+
+    def InternalDeliveryEntry(self):
+        while True:
+            with self.m_cond:
+                while not self.m_closed:
+                    if self.m_in_flight:
+                        wait = self.m_in_flight[0][0] - time.monotonic()
+                        if wait <= 0:
+                            break
+                        self.m_cond.wait(wait)
+                    else:
+                        self.m_cond.wait()
+                if self.m_closed:
+                    self.m_in_flight = []
+                    return
+                _, _, datagram = heapq.heappop(self.m_in_flight)
+                self.m_stats["delivered"] += 1
+
+            try:
+                self.m_transport.sendDatagram(datagram)
+            except Exception as e:
+                print(f"Error in network emulator: {e}")
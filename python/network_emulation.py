@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""
+DroneEngage DataBus - throughput and recovery over an emulated link
+
+Two modules run in this process, connected through a stand-in for de_comm over a CMemoryNetwork:
+
+    sender module --> de_comm stand-in --[CNetworkEmulator]--> receiver module
+
+The stand-in relays every message from the sender over an impaired link to the receiver. The link runs on a
+CVirtualClock, and only relayed messages cross it (ID messages and their replies do not). So the same arguments
+and seed always give the same report.
+"""
+
+import argparse
+import contextlib
+import hashlib
+import json
+import os
+import sys
+import time
+
+try:
+    from .de_module import CModule
+    from .memoryTransport import CMemoryNetwork, CMemoryTransport
+    from .networkEmulator import CNetworkEmulator, CVirtualClock
+    from .messages import *
+except ImportError:
+    from de_module import CModule
+    from memoryTransport import CMemoryNetwork, CMemoryTransport
+    from networkEmulator import CNetworkEmulator, CVirtualClock
+    from messages import *
+
+
+COMM_PORT = 60000
+RELAY_PORT = 60001
+SENDER_PORT = 61001
+RECEIVER_PORT = 61002
+# the receiver's ID messages go nowhere, so nothing but relayed messages reaches it.
+UNUSED_PORT = 60999
+
+RECEIVER_PARTY_ID = "receiver"
+# seconds of virtual time per clock step, the resolution of the report.
+CLOCK_STEP = 0.001
+ENVELOPE_SIZE = 130
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Throughput and recovery of the DataBus chunking protocol over an emulated link")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the link impairments (default: 1)")
+    parser.add_argument("--loss", type=float, default=0.01, help="datagram loss probability (default: 0.01)")
+    parser.add_argument("--duplicate", type=float, default=0.0, help="datagram duplication probability (default: 0)")
+    parser.add_argument("--reorder", type=float, default=0.0, help="datagram reorder probability (default: 0)")
+    parser.add_argument("--delay", type=float, default=0.02, help="one way delay in seconds (default: 0.02)")
+    parser.add_argument("--jitter", type=float, default=0.0005, help="uniform jitter in seconds (default: 0.0005)")
+    parser.add_argument("--rate", type=int, default=1000000, help="link rate in bytes per second, 0 is unlimited (default: 1000000)")
+    parser.add_argument("--chunk", type=int, default=1024, help="chunk size on the link in bytes (default: 1024)")
+    parser.add_argument("--size", type=int, default=4096, help="message size in bytes (default: 4096)")
+    parser.add_argument("--count", type=int, default=500, help="messages to send (default: 500)")
+    parser.add_argument("--interval", type=float, default=0.005, help="seconds between messages (default: 0.005)")
+    parser.add_argument("--outage-at", type=float, default=1.0, help="second the link is cut at (default: 1.0)")
+    parser.add_argument("--outage", type=float, default=0.3, help="seconds the link stays cut, 0 for none (default: 0.3)")
+    return parser.parse_args()
+
+
+class CCommStandIn(object):
+    """Answers the sender's ID messages that ask for a reply, as de_comm does, and relays everything else to the
+    receiver over the link."""
+
+    def __init__(self, network, link):
+        self.m_link = link
+        self.m_transport = CMemoryTransport(network)
+        self.m_transport.init("127.0.0.1", SENDER_PORT, "0.0.0.0", COMM_PORT, 0, self.onReceive)
+        self.m_transport.start()
+
+    def onReceive(self, message, length):
+        header = json.loads(bytes(message).split(b'\0', 1)[0])
+        if header.get(ANDRUAV_PROTOCOL_MESSAGE_TYPE) != TYPE_AndruavModule_ID:
+            self.m_link.sendMSG(message, length)
+            return
+        if not header.get(ANDRUAV_PROTOCOL_MESSAGE_CMD, {}).get(JSON_INTERMODULE_RESEND):
+            return
+        reply = json.dumps({
+            INTERMODULE_ROUTING_TYPE: CMD_TYPE_INTERMODULE,
+            ANDRUAV_PROTOCOL_MESSAGE_TYPE: TYPE_AndruavModule_ID,
+            ANDRUAV_PROTOCOL_MESSAGE_CMD: {
+                JSON_INTERMODULE_PARTY_RECORD: {ANDRUAV_PROTOCOL_SENDER: "comm", ANDRUAV_PROTOCOL_GROUP_ID: "1"}
+            }
+        }).encode()
+        self.m_transport.sendMSG(reply, len(reply))
+
+    def stop(self):
+        self.m_transport.stop()
+
+
+def run(args):
+    clock = CVirtualClock()
+    network = CMemoryNetwork()
+
+    link = CNetworkEmulator(CMemoryTransport(network), seed=args.seed, loss=args.loss, duplicate=args.duplicate,
+                            reorder=args.reorder, delay=args.delay, jitter=args.jitter, rate=args.rate, clock=clock)
+    link.init("127.0.0.1", RECEIVER_PORT, "0.0.0.0", RELAY_PORT, args.chunk, None)
+    link.start()
+    comm = CCommStandIn(network, link)
+
+    # the envelope takes about ENVELOPE_SIZE bytes of each message.
+    padding = "x" * max(0, args.size - ENVELOPE_SIZE)
+    # message sequence -> virtual send time; (sequence, virtual arrival time, length, intact) in arrival order.
+    sent_at = {}
+    arrivals = []
+
+    def on_receive(message, length, jMsg):
+        cmd = jMsg.get(ANDRUAV_PROTOCOL_MESSAGE_CMD, {})
+        if "s" in cmd:
+            # the chunk protocol cannot tell a missing or reordered middle chunk, the padding can.
+            arrivals.append((cmd["s"], clock.now(), length, cmd.get("p") == padding))
+
+    receiver = CModule.createInstance()
+    receiver.defineModule("gen", "receiver", "receiver_key", "1.0", [])   # MODULE_CLASS_GENERIC
+    receiver.m_OnReceive = on_receive
+    receiver.init("127.0.0.1", UNUSED_PORT, "0.0.0.0", RECEIVER_PORT, transport=CMemoryTransport(network))
+
+    sender = CModule.createInstance()
+    sender.defineModule("gen", "sender", "sender_key", "1.0", [])   # MODULE_CLASS_GENERIC
+    sender.init("127.0.0.1", COMM_PORT, "0.0.0.0", SENDER_PORT, transport=CMemoryTransport(network))
+
+    try:
+        # the ID handshake runs in real time.
+        deadline = time.monotonic() + 5.0
+        while not sender.isLinkConnected() and time.monotonic() < deadline:
+            time.sleep(0.05)
+        if not sender.isLinkConnected():
+            raise Exception("sender did not connect to the de_comm stand-in")
+
+        outage_end = args.outage_at + args.outage
+        cut = False
+        restored = args.outage <= 0
+        sequence = 0
+
+        while True:
+            now = clock.now()
+            if not cut and args.outage > 0 and now >= args.outage_at:
+                link.configure(loss=1.0)
+                cut = True
+            if cut and not restored and now >= outage_end:
+                link.configure(loss=args.loss)
+                restored = True
+
+            while sequence < args.count and sequence * args.interval <= now + 1e-9:
+                sent_at[sequence] = now
+                sender.sendJMSG(RECEIVER_PARTY_ID, {"s": sequence, "p": padding}, TYPE_AndruavMessage_DUMMY, False)
+                sequence += 1
+
+            # the relay draws its impairments at virtual time now.
+            network.waitIdle()
+            if sequence >= args.count and clock.nextEventTime() is None:
+                break
+            clock.advance(CLOCK_STEP)
+            network.waitIdle()
+
+        stats = link.getStats()
+    finally:
+        sender.uninit()
+        receiver.uninit()
+        comm.stop()
+        link.stop()
+
+    return sent_at, arrivals, stats
+
+
+def report(args, sent_at, arrivals, stats):
+    delivered = {}
+    corrupted = set()
+    for sequence, arrival, length, intact in arrivals:
+        if intact:
+            delivered.setdefault(sequence, (arrival, length))
+        else:
+            corrupted.add(sequence)
+    corrupted -= set(delivered)
+
+    outage_end = args.outage_at + args.outage
+    in_outage = lambda sequence: args.outage > 0 and args.outage_at <= sent_at[sequence] < outage_end
+    lost = [sequence for sequence in sent_at if sequence not in delivered]
+    lost_in_outage = sum(1 for sequence in lost if in_outage(sequence))
+
+    first_sent = min(sent_at.values())
+    last_arrival = max((arrival for arrival, _ in delivered.values()), default=first_sent)
+    duration = max(last_arrival - first_sent, CLOCK_STEP)
+    delivered_bytes = sum(length for _, length in delivered.values())
+    message_bytes = delivered_bytes / len(delivered) if delivered else args.size
+    latencies = [arrival - sent_at[sequence] for sequence, (arrival, _) in delivered.items()]
+
+    print(f"link        loss {args.loss:.1%}, delay {args.delay * 1000:.0f} ms, jitter {args.jitter * 1000:.1f} ms, "
+          f"rate {args.rate} B/s, chunk {args.chunk} B, seed {args.seed}")
+    print(f"sent        {len(sent_at)} messages of {message_bytes:.0f} B, one every {args.interval * 1000:.1f} ms")
+    print(f"delivered   {len(delivered)} ({len(delivered) / len(sent_at):.1%}), lost {len(lost)}: "
+          f"{lost_in_outage} sent during the outage, {len(lost) - lost_in_outage} to impairments "
+          f"({len(corrupted)} of them delivered corrupted)")
+    print(f"throughput  {delivered_bytes / duration / 1000:.1f} kB/s of {message_bytes / args.interval / 1000:.1f} kB/s offered, "
+          f"over {duration:.3f} s")
+    if latencies:
+        print(f"latency     mean {sum(latencies) / len(latencies) * 1000:.1f} ms, max {max(latencies) * 1000:.1f} ms")
+
+    if args.outage > 0:
+        after = [delivered[sequence][0] for sequence in delivered if sent_at[sequence] >= outage_end]
+        broken = sum(1 for sequence in lost if sent_at[sequence] >= outage_end)
+        if after:
+            print(f"recovery    link cut {args.outage_at:.3f} s to {outage_end:.3f} s, first message sent after it "
+                  f"delivered {(min(after) - outage_end) * 1000:.1f} ms later, {broken} lost after it")
+        else:
+            print(f"recovery    link cut {args.outage_at:.3f} s to {outage_end:.3f} s, no message delivered after it")
+
+    print(f"emulator    {json.dumps(stats)}")
+    order = hashlib.sha1(json.dumps([(sequence, round(arrival, 6), length) for sequence, arrival, length, _ in arrivals]).encode())
+    print(f"digest      {order.hexdigest()[:16]}  (same arguments and seed, same digest)")
+
+
+def main():
+    args = parse_args()
+    # the modules log every chunk and message.
+    with open(os.devnull, "w") as devnull, contextlib.redirect_stdout(devnull):
+        sent_at, arrivals, stats = run(args)
+    report(args, sent_at, arrivals, stats)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,174 @@
+import threading
+import time
+
+
+class CPublisher(object):
+
+    def __init__(self, publisher_id, period, callback, rate):
+        self.m_id = publisher_id
+        self.m_period = period
+        self.m_callback = callback
+        self.m_stats = {"rate": rate, "runs": 0, "overruns": 0,
+                        "jitter_last": 0.0, "jitter_max": 0.0, "jitter_mean": 0.0}
+
+
+class CPeriodicPublisher(object):
+    """Calls producer callbacks at fixed rates from one thread.
+
+    Deadlines are absolute and aligned to a common epoch, so they do not drift and
+    harmonic rates fire on the same wakeup. Publishers with the same rate share one
+    rate group and one deadline. A group that wakes up late by whole periods skips
+    them instead of bursting to catch up; skipped periods are counted as overruns.
+    The thread sleeps while no publisher is registered.
+    """
+
+    def __init__(self):
+        self.m_publishers = {}
+        # period -> [next deadline, [publishers]]
+        self.m_groups = {}
+        self.m_next_id = 0
+        self.m_epoch = None
+        self.m_stopped_called = False
+        self.m_thread = None
+        self.m_lock = threading.Lock()
+        self.m_cond = threading.Condition(self.m_lock)
+        # publisher whose callback is running and the thread running it, signalled on
+        # m_callback_done when it returns.
+        self.m_running_id = None
+        self.m_running_thread = None
+        self.m_callback_done = threading.Condition(self.m_lock)
+
+    def start(self):
+        if self.m_thread is not None:
+            return
+        with self.m_cond:
+            # periods passed while stopped are not overruns.
+            now = time.monotonic()
+            for period, group in self.m_groups.items():
+                if group[0] <= now:
+                    group[0] = self.m_epoch + (int((now - self.m_epoch) / period) + 1) * period
+        self.m_stopped_called = False
+        self.m_thread = threading.Thread(target=self.InternalPublisherEntry, daemon=True)
+        self.m_thread.start()
+
+    def stop(self):
+        with self.m_cond:
+            self.m_stopped_called = True
+            self.m_cond.notify()
+        if self.m_thread and self.m_thread.is_alive() and self.m_thread is not threading.current_thread():
+            self.m_thread.join(timeout=1.0)
+        self.m_thread = None
+
+    def addPublisher(self, rate, callback):
+        """Call callback() rate times per second. Returns a publisher id."""
+        if rate <= 0:
+            raise ValueError("rate must be positive")
+        with self.m_cond:
+            publisher = CPublisher(self.m_next_id, 1.0 / rate, callback, rate)
+            self.m_next_id += 1
+            self.m_publishers[publisher.m_id] = publisher
+            self._joinGroup(publisher)
+            self.m_cond.notify()
+        return publisher.m_id
+
+    def removePublisher(self, publisher_id):
+        """Waits for a running callback of the publisher, so it is not called once this
+        returns. A callback may remove its own publisher. Returns False for unknown ids."""
+        with self.m_cond:
+            publisher = self.m_publishers.pop(publisher_id, None)
+            if publisher is None:
+                return False
+            self._leaveGroup(publisher)
+            # a callback removing its own publisher cannot wait for itself.
+            if threading.current_thread() is not self.m_running_thread:
+                while self.m_running_id == publisher_id:
+                    self.m_callback_done.wait()
+            return True
+
+    def setRate(self, publisher_id, rate):
+        """Move the publisher to the rate group of rate, from the next deadline of that group."""
+        if rate <= 0:
+            raise ValueError("rate must be positive")
+        with self.m_cond:
+            publisher = self.m_publishers.get(publisher_id)
+            if publisher is None:
+                return False
+            publisher.m_stats["rate"] = rate
+            if publisher.m_period == 1.0 / rate:
+                return True
+            self._leaveGroup(publisher)
+            publisher.m_period = 1.0 / rate
+            self._joinGroup(publisher)
+            self.m_cond.notify()
+            return True
+
+    def getStats(self, publisher_id):
+        """rate, runs, overruns and jitter_last/max/mean in seconds (call time - deadline)."""
+        with self.m_cond:
+            publisher = self.m_publishers.get(publisher_id)
+            return dict(publisher.m_stats) if publisher else None
+
+    def _joinGroup(self, publisher):
+        # a new group gets the first deadline after now on the grid of its period from m_epoch.
+        group = self.m_groups.get(publisher.m_period)
+        if group is None:
+            now = time.monotonic()
+            if self.m_epoch is None:
+                self.m_epoch = now
+            deadline = self.m_epoch + (int((now - self.m_epoch) / publisher.m_period) + 1) * publisher.m_period
+            group = self.m_groups[publisher.m_period] = [deadline, []]
+        group[1].append(publisher)
+
+    def _leaveGroup(self, publisher):
+        group = self.m_groups.get(publisher.m_period)
+        if group is None:
+            return
+        group[1].remove(publisher)
+        if not group[1]:
+            del self.m_groups[publisher.m_period]
+
+    def InternalPublisherEntry(self):
+        while True:
+            due = []
+            with self.m_cond:
+                while not self.m_groups and not self.m_stopped_called:
+                    self.m_cond.wait()
+                if self.m_stopped_called:
+                    return
+                now = time.monotonic()
+                next_deadline = min(group[0] for group in self.m_groups.values())
+                if now < next_deadline:
+                    self.m_cond.wait(next_deadline - now)
+                    continue
+
+                # every group due by now runs on this one wakeup.
+                for period, group in self.m_groups.items():
+                    deadline = group[0]
+                    if deadline > now:
+                        continue
+                    missed = int((now - deadline) / period)
+                    group[0] = deadline + (missed + 1) * period
+                    due.extend((publisher, deadline, missed) for publisher in group[1])
+
+            # callbacks run outside the lock so they may send, change rates or remove publishers.
+            for publisher, deadline, missed in due:
+                with self.m_cond:
+                    if publisher.m_id not in self.m_publishers:
+                        continue
+                    self.m_running_id = publisher.m_id
+                    self.m_running_thread = threading.current_thread()
+                jitter = time.monotonic() - deadline
+                try:
+                    publisher.m_callback()
+                except Exception as e:
+                    print(f"Error in publisher callback: {e}")
+                with self.m_cond:
+                    self.m_running_id = None
+                    self.m_running_thread = None
+                    self.m_callback_done.notify_all()
+                    stats = publisher.m_stats
+                    stats["runs"] += 1
+                    stats["overruns"] += missed
+                    stats["jitter_last"] = jitter
+                    stats["jitter_max"] = max(stats["jitter_max"], jitter)
+                    stats["jitter_mean"] += (jitter - stats["jitter_mean"]) / stats["runs"]
@@ -8,25 +8,21 @@ import sys
 import signal
 import time
 import argparse
-import threading
-from typing import Optional
 
 try:
     from .de_module import CModule
+    from .udpClient import UDP_DATABUS_PACKET_SIZE_AUTO
     from .de_facade_base import CFacade_Base
     from .colors import Colors
     from .messages import *
 except ImportError:
     from de_module import CModule
+    from udpClient import UDP_DATABUS_PACKET_SIZE_AUTO
     from de_facade_base import CFacade_Base
     from console_colors import Colors
     from messages import *
 
-
-DEFAULT_UDP_DATABUS_PACKET_SIZE = 8192
-
 shutdown_requested = False
-interval_thread: Optional[threading.Thread] = None
 
 
 def signal_handler(signum, frame):
@@ -116,19 +112,16 @@ def parse_arguments():
     return args
 
 
-def message_loop():
-    """Main message sending loop"""
-    global shutdown_requested
-    
-    while not shutdown_requested:
+def publish_msg():
+    """Called every second by the module's periodic publisher"""
+    if not shutdown_requested:
         print("Client Module RUNNING")
         send_msg()
-        time.sleep(1)
 
 
 def main():
     """Main function"""
-    global c_module, base_facade, interval_thread
+    global c_module, base_facade
     
     # Set up signal handlers
     signal.signal(signal.SIGINT, signal_handler)
@@ -168,16 +161,15 @@ def main():
     
     # Initialize UDP communication
     try:
-        c_module.init("0.0.0.0", target_port, "0.0.0.0", listen_port, DEFAULT_UDP_DATABUS_PACKET_SIZE)
+        c_module.init("0.0.0.0", target_port, "0.0.0.0", listen_port, UDP_DATABUS_PACKET_SIZE_AUTO)
     except Exception as e:
         print(f"{Colors.ERROR_CONSOLE_TEXT}Failed to initialize module: {e}{Colors.NORMAL_CONSOLE_TEXT}")
         sys.exit(1)
     
     print("Client Module RUNNING")
     
-    # Start message sending loop
-    interval_thread = threading.Thread(target=message_loop, daemon=True)
-    interval_thread.start()
+    # Send once a second from the module's publisher thread
+    c_module.addPeriodicPublisher(1.0, publish_msg)
     
     try:
         # Keep main thread alive
@@ -185,10 +177,6 @@ def main():
             time.sleep(0.1)
     except KeyboardInterrupt:
         signal_handler(signal.SIGINT, None)
-    
-    # Wait for cleanup
-    if interval_thread and interval_thread.is_alive():
-        interval_thread.join(timeout=2)
 
 
 if __name__ == "__main__":
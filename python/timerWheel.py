@@ -0,0 +1,97 @@
+import threading
+import time
+
+
+class CTimerWheelEntry(object):
+
+    def __init__(self, rounds, callback):
+        self.m_rounds = rounds
+        self.m_callback = callback
+        self.m_cancelled = False
+
+    def cancel(self):
+        self.m_cancelled = True
+
+
+class CTimerWheel(object):
+    """Hashed timer wheel used to expire pending requests.
+
+    Timers are rounded up to the tick resolution. The wheel thread sleeps
+    while no timer is scheduled so an idle module costs no wakeups.
+    """
+
+    def __init__(self, tick=0.05, slots=64):
+        self.m_tick = tick
+        self.m_slots = [[] for _ in range(slots)]
+        self.m_cursor = 0
+        self.m_count = 0
+        self.m_next_tick = 0
+        self.m_stopped_called = False
+        self.m_thread = None
+        self.m_cond = threading.Condition()
+
+    def start(self):
+        if self.m_thread is not None:
+            return
+        with self.m_cond:
+            # restartable after stop(), e.g. CModule.uninit() then init().
+            self.m_stopped_called = False
+            self.m_next_tick = time.monotonic() + self.m_tick
+        self.m_thread = threading.Thread(target=self.InternalTickEntry, daemon=True)
+        self.m_thread.start()
+
+    def stop(self):
+        with self.m_cond:
+            self.m_stopped_called = True
+            self.m_cond.notify()
+        if self.m_thread and self.m_thread.is_alive():
+            self.m_thread.join(timeout=1.0)
+        self.m_thread = None
+
+    def schedule(self, delay, callback):
+        """Call callback after delay seconds. Returns an entry that can be cancelled."""
+        ticks = max(1, int((delay + self.m_tick - 1e-9) / self.m_tick))
+        with self.m_cond:
+            slot = (self.m_cursor + ticks) % len(self.m_slots)
+            entry = CTimerWheelEntry((ticks - 1) // len(self.m_slots), callback)
+            self.m_slots[slot].append(entry)
+            if self.m_count == 0:
+                self.m_next_tick = time.monotonic() + self.m_tick
+            self.m_count += 1
+            self.m_cond.notify()
+        return entry
+
+    def InternalTickEntry(self):
+        while True:
+            with self.m_cond:
+                while self.m_count == 0 and not self.m_stopped_called:
+                    self.m_cond.wait()
+                if self.m_stopped_called:
+                    return
+                now = time.monotonic()
+                if now < self.m_next_tick:
+                    self.m_cond.wait(self.m_next_tick - now)
+                    continue
+                self.m_next_tick += self.m_tick
+
+                self.m_cursor = (self.m_cursor + 1) % len(self.m_slots)
+                slot = self.m_slots[self.m_cursor]
+                expired = []
+                remaining = []
+                for entry in slot:
+                    if entry.m_cancelled:
+                        self.m_count -= 1
+                    elif entry.m_rounds > 0:
+                        entry.m_rounds -= 1
+                        remaining.append(entry)
+                    else:
+                        self.m_count -= 1
+                        expired.append(entry)
+                self.m_slots[self.m_cursor] = remaining
+
+            # callbacks run outside the lock so they may schedule new timers.
+            for entry in expired:
+                try:
+                    entry.m_callback()
+                except Exception as e:
+                    print(f"Error in timer callback: {e}")
@@ -0,0 +1,408 @@
+import threading
+import time
+from collections import deque
+
+
+DEFAULT_UDP_DATABUS_PACKET_SIZE = 8192
+# pass as chunkSize to choose the chunk size from the path to de_comm.
+UDP_DATABUS_PACKET_SIZE_AUTO = 0
+
+UDP_MAX_DATAGRAM_SIZE = 65507
+UDP_CHUNK_HEADER_SIZE = 2
+
+# delay after every DEFAULT_UDP_DATABUS_PACKET_SIZE bytes of one message, scaled to the chunk length so the
+# send rate does not depend on the chunk size. Fast sending causes packet loss.
+DEFAULT_CHUNK_PACING = 0.01
+
+UDP_LAST_CHUNK_NUMBER = 0xFFFF
+# a forwarded message whose last chunk has not arrived within this many seconds is abandoned.
+FORWARD_STALL_TIMEOUT = 1.0
+
+
+class CTransport(object):
+    """Base transport used by CModule.
+
+    Implements the databus chunking protocol, reassembly and the periodic ID sender.
+    Subclasses only move datagrams: open(), close(), sendDatagram() and receiveDatagram().
+    """
+
+    def __init__(self):
+        self.m_ModuleAddress = None
+        self.m_CommunicatorModuleAddress = None
+        self.m_chunkSize = 0
+        self.m_localChunkSize = 0
+        self.m_chunkSizePinned = False
+        self.m_chunkPacing = DEFAULT_CHUNK_PACING
+        self.m_stopped_called = False
+        self.m_starrted = False
+        self.m_threadReceiver = None
+        self.m_threadSenderID = None
+        self.m_callback = None
+        self.m_JsonID = ""
+        self.m_idInterval = 1.0
+        self.m_idWake = threading.Event()
+        self.m_idTickCallback = None
+        self.m_chunkHandler = None
+        # local messages sent while a forwarded message is in flight wait in m_sendQueue.
+        self.m_forwardSession = 0
+        self.m_forwardSessionCounter = 0
+        self.m_forwardChunk = 0
+        self.m_forwardActivity = 0
+        self.m_forwardTimer = None
+        self.m_sendQueue = deque()
+        self.m_lock = threading.Lock()
+        self.m_sendCond = threading.Condition(self.m_lock)
+        self.m_lock2 = threading.Lock()
+
+    def __del__(self):
+        if self.m_starrted and not self.m_stopped_called:
+            self.stop()
+
+    def init(self, targetIP, broadcastPort, host, listeningPort, chunkSize, onReceiveCallback):
+        self.m_chunkSizePinned = chunkSize > UDP_DATABUS_PACKET_SIZE_AUTO
+        self.m_localChunkSize = chunkSize if self.m_chunkSizePinned else self.detectChunkSize(targetIP, broadcastPort)
+        # until the peer advertises its chunk size, send what a legacy receiver accepts.
+        self.m_chunkSize = self.m_localChunkSize if self.m_chunkSizePinned else min(self.m_localChunkSize, DEFAULT_UDP_DATABUS_PACKET_SIZE)
+        self.m_callback = onReceiveCallback
+        self.m_ModuleAddress = (host, listeningPort)
+        self.m_CommunicatorModuleAddress = (targetIP, broadcastPort)
+        self.open()
+
+    # datagram layer, implemented by subclasses.
+
+    def open(self):
+        """Start listening on m_ModuleAddress."""
+        raise NotImplementedError
+
+    def close(self):
+        """Stop listening. A blocked receiveDatagram() must return."""
+        raise NotImplementedError
+
+    def sendDatagram(self, datagram):
+        """Send one chunk to m_CommunicatorModuleAddress."""
+        raise NotImplementedError
+
+    def receiveDatagram(self, timeout):
+        """Return the next received chunk, or None if nothing arrived within timeout seconds."""
+        raise NotImplementedError
+
+    def detectChunkSize(self, targetIP, targetPort):
+        return DEFAULT_UDP_DATABUS_PACKET_SIZE
+
+    def setChunkSize(self, chunkSize, pinned=True):
+        """Set the chunk size. A pinned size is never replaced by negotiation."""
+        if chunkSize <= UDP_DATABUS_PACKET_SIZE_AUTO:
+            return
+        with self.m_lock:
+            self.m_chunkSize = min(chunkSize, UDP_MAX_DATAGRAM_SIZE - UDP_CHUNK_HEADER_SIZE)
+            self.m_localChunkSize = self.m_chunkSize
+            self.m_chunkSizePinned = pinned
+
+    def negotiateChunkSize(self, peerChunkSize):
+        """Agree on the smaller of our chunk size and the one advertised by the peer.
+
+        Called when the peer's ID reply carries its chunk size. Peers that never
+        advertise one keep receiving DEFAULT_UDP_DATABUS_PACKET_SIZE chunks.
+        """
+        if peerChunkSize <= 0:
+            return
+        with self.m_lock:
+            if self.m_chunkSizePinned:
+                return
+            self.m_chunkSize = min(self.m_localChunkSize, peerChunkSize)
+
+    def setChunkPacing(self, pacing):
+        """Seconds to wait after every DEFAULT_UDP_DATABUS_PACKET_SIZE bytes of one message."""
+        self.m_chunkPacing = pacing
+
+    def chunkPause(self, chunk_length):
+        """Seconds to wait after a chunk of chunk_length bytes."""
+        return self.m_chunkPacing * chunk_length / DEFAULT_UDP_DATABUS_PACKET_SIZE
+
+    def start(self):
+        if self.m_starrted:
+            raise Exception("Starrted called twice")
+        self.startReceiver()
+        self.startSenderID()
+        self.m_starrted = True
+
+    def startReceiver(self):
+        self.m_threadReceiver = threading.Thread(target=self.InternalReceiverEntry)
+        self.m_threadReceiver.start()
+
+    def startSenderID(self):
+        self.m_threadSenderID = threading.Thread(target=self.InternelSenderIDEntry)
+        self.m_threadSenderID.start()
+
+    def stop(self):
+        self.m_stopped_called = True
+        self.m_idWake.set()
+        with self.m_sendCond:
+            if self.m_forwardTimer:
+                self.m_forwardTimer.cancel()
+            self.m_forwardSession = 0
+            self.m_sendQueue.clear()
+
+        # Close first to stop blocking operations
+        try:
+            self.close()
+        except Exception as e:
+            print(f"Error closing transport: {e}")
+
+        # Wait for threads to finish
+        if self.m_starrted:
+            try:
+                if self.m_threadReceiver and self.m_threadReceiver.is_alive():
+                    self.m_threadReceiver.join(timeout=5.0)
+                if self.m_threadSenderID and self.m_threadSenderID.is_alive():
+                    self.m_threadSenderID.join(timeout=5.0)
+            except Exception as e:
+                print(f"Error joining threads: {e}")
+
+        # Clear references properly
+        self.m_ModuleAddress = None
+        self.m_CommunicatorModuleAddress = None
+
+    def setChunkHandler(self, handler):
+        """handler(datagram, chunkNumber, first) sees every received chunk before reassembly.
+
+        first is True when no chunk of the current message has been kept yet.
+        Returning True consumes the chunk, it is not reassembled.
+        """
+        self.m_chunkHandler = handler
+
+    def InternalReceiverEntry(self):
+        receivedChunks = []
+        while not self.m_stopped_called:
+            try:
+                received = self.receiveDatagram(1.0)
+                if received is None:
+                    # Timeout is expected - allows checking m_stopped_called
+                    continue
+                if len(received) > 0:
+                    chunkNumber = (received[1] << 8) | received[0]
+                    if chunkNumber == 0:
+                        receivedChunks = []
+                    if self.m_chunkHandler and self.m_chunkHandler(received, chunkNumber, len(receivedChunks) == 0):
+                        continue
+                    receivedChunks.append(received[2:])
+                    if chunkNumber == 0xFFFF:
+                        concatenatedData = b''.join(receivedChunks)
+                        #concatenatedData += b"\0"
+                        if self.m_callback:
+                            self.m_callback(concatenatedData, len(concatenatedData))
+                        receivedChunks = []
+            except Exception as e:
+                if not self.m_stopped_called:
+                    print(f"Error in receiver thread: {e}")
+                break
+
+    def setJsonId(self, jsonID):
+        self.m_JsonID = jsonID
+
+    def setIdInterval(self, interval, wake=False):
+        """Seconds between ID messages. wake sends the next ID immediately."""
+        self.m_idInterval = interval
+        if wake:
+            self.m_idWake.set()
+
+    def setIdTickCallback(self, callback):
+        """callback() is called on the sender thread before each ID message."""
+        self.m_idTickCallback = callback
+
+    def InternelSenderIDEntry(self):
+        while not self.m_stopped_called:
+            try:
+                if self.m_idTickCallback:
+                    self.m_idTickCallback()
+                with self.m_lock2:
+                    if self.m_JsonID and not self.m_stopped_called:
+                        msg = self.m_JsonID
+                        self.sendMSG(msg.encode(), len(msg))
+                self.m_idWake.wait(self.m_idInterval)
+                self.m_idWake.clear()
+            except Exception as e:
+                if not self.m_stopped_called:
+                    print(f"Error in sender thread: {e}")
+                break
+
+    def _endForwardSession(self):
+        """Called with m_sendCond held. Sends the messages queued during the session."""
+        if self.m_forwardTimer:
+            self.m_forwardTimer.cancel()
+            self.m_forwardTimer = None
+        self.m_forwardSession = 0
+        while self.m_sendQueue and not self.m_stopped_called:
+            msg = self.m_sendQueue.popleft()
+            self._sendChunks(msg, len(msg))
+
+    def _armForwardStall(self, session, delay):
+        self.m_forwardTimer = threading.Timer(delay, self.InternalForwardStallEntry, args=(session,))
+        self.m_forwardTimer.daemon = True
+        self.m_forwardTimer.start()
+
+    def InternalForwardStallEntry(self, session):
+        with self.m_sendCond:
+            if self.m_forwardSession != session:
+                return
+            remaining = self.m_forwardActivity + FORWARD_STALL_TIMEOUT - time.monotonic()
+            if remaining > 0:
+                self._armForwardStall(session, remaining)
+                return
+            # the last chunk never came, the rest of the message is dropped.
+            self._endForwardSession()
+
+    def endForwardSession(self):
+        """Abandon the forwarded message in flight, its remaining chunks are dropped."""
+        with self.m_sendCond:
+            if self.m_forwardSession:
+                self._endForwardSession()
+
+    def isForwarding(self):
+        """True while a forwarded message is in flight and its last chunk has not been sent."""
+        return self.m_forwardSession != 0
+
+    def forwardDatagram(self, datagram, first):
+        """Cut-through relay of a received chunk.
+
+        Chunks of one forwarded message are kept together on the wire: sendMSG() calls
+        made before its last chunk are queued and sent after it. The datagram is sent
+        as is when it fits the chunk size, otherwise it is split and renumbered.
+        """
+        chunkNumber = (datagram[1] << 8) | datagram[0]
+        last = chunkNumber == UDP_LAST_CHUNK_NUMBER
+        with self.m_sendCond:
+            if self.m_stopped_called:
+                return
+            if first:
+                if self.m_forwardSession:
+                    self._endForwardSession()
+                self.m_forwardSessionCounter += 1
+                self.m_forwardSession = self.m_forwardSessionCounter
+                self.m_forwardChunk = 0
+                if not last:
+                    self._armForwardStall(self.m_forwardSession, FORWARD_STALL_TIMEOUT)
+            elif not self.m_forwardSession:
+                # the rest of a message abandoned after FORWARD_STALL_TIMEOUT.
+                return
+            self.m_forwardActivity = time.monotonic()
+            try:
+                if len(datagram) - UDP_CHUNK_HEADER_SIZE <= self.m_chunkSize and (last or chunkNumber == self.m_forwardChunk):
+                    self.sendDatagram(datagram)
+                    self.m_forwardChunk += 1
+                else:
+                    payload = memoryview(datagram)[UDP_CHUNK_HEADER_SIZE:]
+                    offset = 0
+                    # an empty last chunk is still sent, it ends the message.
+                    while True:
+                        piece = payload[offset:offset + self.m_chunkSize]
+                        offset += len(piece)
+                        number = UDP_LAST_CHUNK_NUMBER if last and offset >= len(payload) else self.m_forwardChunk
+                        self.sendDatagram(bytes([number & 0xFF, (number >> 8) & 0xFF]) + piece)
+                        self.m_forwardChunk += 1
+                        if offset >= len(payload):
+                            break
+            finally:
+                if last:
+                    self._endForwardSession()
+
+    def sendMSG(self, msg, length):
+        with self.m_sendCond:
+            if self.m_stopped_called:
+                return
+            if self.m_forwardSession:
+                self.m_sendQueue.append(bytes(msg[:length]))
+                return
+            self._sendChunks(msg, length)
+
+    def _sendChunks(self, msg, length):
+        """Called with m_sendCond held."""
+        try:
+            remaining_length = length
+            offset = 0
+            chunk_number = 0
+
+            while remaining_length > 0 and not self.m_stopped_called:
+                chunk_length = min(self.m_chunkSize, remaining_length)
+                remaining_length -= chunk_length
+
+                # Create a new message with the chunk size + sizeof(uint8_t)
+                total_length = chunk_length + 2
+                chunk_msg = bytearray(total_length)
+
+                # Set the first two bytes as chunk number
+                if remaining_length == 0:
+                    # Last packet is always equal to 255 (0xff) regardless if its actual number.
+                    chunk_msg[0] = 0xFF
+                    chunk_msg[1] = 0xFF
+                else:
+                    chunk_msg[0] = chunk_number & 0xFF
+                    chunk_msg[1] = (chunk_number >> 8) & 0xFF
+
+                print(f"chunkNumber:{chunk_number} :chunkLength :{chunk_length}")
+
+
+                # Copy the chunk data into the message
+                chunk_msg[2:total_length] = msg[offset:offset+chunk_length]
+
+
+                self.sendDatagram(chunk_msg)
+
+                if remaining_length != 0 and self.m_chunkPacing > 0:
+                    # Fast sending causes packet loss.
+                    time.sleep(self.chunkPause(chunk_length))
+
+                offset += chunk_length
+                chunk_number += 1
+
+        except Exception as e:
+            if not self.m_stopped_called:
+                print(f"DEBUG: InternelSenderIDEntry EXIT\n{e}")
+
+    def sendFanOut(self, heads, tail):
+        """Send the messages head + tail for every head in heads.
+
+        tail is chunked once: only the first chunk, which carries the head, differs
+        between messages, the datagrams of the rest of tail are shared.
+        """
+        if not heads:
+            return
+        first_room = self.m_chunkSize - max(len(head) for head in heads)
+        if first_room <= 0:
+            # a head fills the first chunk, nothing to share.
+            for head in heads:
+                msg = head + tail
+                self.sendMSG(msg, len(msg))
+            return
+
+        with self.m_sendCond:
+            if self.m_stopped_called:
+                return
+            if self.m_forwardSession:
+                for head in heads:
+                    self.m_sendQueue.append(head + tail)
+                return
+            try:
+                first_piece = tail[:first_room]
+                shared = []
+                offset = first_room
+                while offset < len(tail):
+                    piece = tail[offset:offset + self.m_chunkSize]
+                    offset += len(piece)
+                    number = UDP_LAST_CHUNK_NUMBER if offset >= len(tail) else len(shared) + 1
+                    shared.append(bytes([number & 0xFF, (number >> 8) & 0xFF]) + piece)
+                first_header = b'\x00\x00' if shared else b'\xff\xff'
+
+                for head in heads:
+                    if self.m_stopped_called:
+                        return
+                    self.sendDatagram(first_header + head + first_piece)
+                    for datagram in shared:
+                        if self.m_chunkPacing > 0:
+                            # Fast sending causes packet loss. Every datagram before this one is a full chunk.
+                            time.sleep(self.chunkPause(self.m_chunkSize))
+                        self.sendDatagram(datagram)
+
+            except Exception as e:
+                if not self.m_stopped_called:
+                    print(f"DEBUG: sendFanOut EXIT\n{e}")